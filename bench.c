@@ -17,13 +17,24 @@
  * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
  * -------------------------------------------------------------------------- */
 #define _XOPEN_SOURCE 700
+#define _DEFAULT_SOURCE
 
 #include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <unistd.h>
+#include <x86intrin.h>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
 
 #include "bench.h"
 
 #define REPS_INIT (99)
+#define TSC_CALIB_NANOS (50000000UL)
 
 int bench_mark(struct bench *b, size_t reps, int (*op)(void *), void *data)
 {
@@ -34,6 +45,7 @@ int bench_mark(struct bench *b, size_t reps, int (*op)(void *), void *data)
 
 	b->nanos = 0;
 	b->reps = 0;
+	b->nev = 0;
 	/* First, warm the cache up */
 	for (volatile size_t i = 0; i < REPS_INIT; i++)
 		if ((rt = op(data)) != 0)
@@ -51,3 +63,193 @@ int bench_mark(struct bench *b, size_t reps, int (*op)(void *), void *data)
 
 	return rt;
 }
+
+static inline uint64_t bench_tsc(void)
+{
+	_mm_lfence();
+	const uint64_t t = __rdtsc();
+	_mm_lfence();
+
+	return t;
+}
+
+static int bench_cmp(const void *a, const void *b)
+{
+	const uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+int bench_sample(struct bench_stats *st, uint64_t *samples, size_t reps,
+		int (*prep)(void *), int (*op)(void *), void *data)
+{
+	int rt = 0;
+	size_t r;
+
+	st->reps = 0;
+	for (volatile size_t i = 0; i < REPS_INIT; i++) {
+		if (prep && (rt = prep(data)) != 0)
+			return rt;
+		if ((rt = op(data)) != 0)
+			return rt;
+	}
+
+	for (r = 0; r < reps; r++) {
+		if (prep && (rt = prep(data)) != 0)
+			break;
+
+		const uint64_t t1 = bench_tsc();
+		rt = op(data);
+		const uint64_t t2 = bench_tsc();
+		if (rt != 0)
+			break;
+		samples[r] = t2 - t1;
+	}
+	if (r == 0)
+		return rt;
+
+	qsort(samples, r, sizeof *samples, bench_cmp);
+
+	double sum = 0.0;
+	for (size_t i = 0; i < r; i++)
+		sum += samples[i];
+	st->reps = r;
+	st->mean = sum / r;
+	st->min = samples[0];
+	st->median = samples[r / 2];
+	st->p99 = samples[r * 99 / 100];
+	st->max = samples[r - 1];
+
+	return rt;
+}
+
+double bench_tsc_hz(void)
+{
+	static double hz = 0.0;
+	if (hz > 0.0)
+		return hz;
+
+	struct timespec t1, t2;
+	unsigned long nanos;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	const uint64_t c1 = bench_tsc();
+	do {
+		clock_gettime(CLOCK_MONOTONIC, &t2);
+		nanos = 1000000000UL * (t2.tv_sec - t1.tv_sec)
+				+ (t2.tv_nsec - t1.tv_nsec);
+	} while (nanos < TSC_CALIB_NANOS);
+	const uint64_t c2 = bench_tsc();
+
+	return hz = (double)(c2 - c1) * 1.0e9 / nanos;
+}
+
+static int bench_nop(void *)
+{
+	return 0;
+}
+
+uint64_t bench_tsc_overhead(void)
+{
+	static uint64_t samples[REPS_INIT * 10];
+	struct bench_stats st;
+
+	bench_sample(&st, samples, REPS_INIT * 10, nullptr, bench_nop, nullptr);
+
+	return st.median;
+}
+
+const struct bench_event BENCH_EVENTS_DEFAULT[BENCH_EVENTS_DEFAULT_NUM] = {
+	{ "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ "l1d_misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D
+		| (PERF_COUNT_HW_CACHE_OP_READ << 8)
+		| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+	{ "branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+};
+
+size_t bench_perf_open(struct bench_perf *pf, const struct bench_event *ev,
+		size_t num)
+{
+	pf->num = 0;
+	for (size_t i = 0; i < num && pf->num < BENCH_PERF_MAX; i++) {
+		struct perf_event_attr attr;
+
+		memset(&attr, 0, sizeof attr);
+		attr.size = sizeof attr;
+		attr.type = ev[i].type;
+		attr.config = ev[i].config;
+		attr.disabled = pf->num == 0;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP
+			| PERF_FORMAT_TOTAL_TIME_ENABLED
+			| PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		const int fd = syscall(SYS_perf_event_open, &attr, 0, -1,
+				pf->num > 0 ? pf->fd[0] : -1, 0);
+		if (fd < 0)
+			continue;
+		pf->fd[pf->num] = fd;
+		pf->name[pf->num++] = ev[i].name;
+	}
+
+	return pf->num;
+}
+
+void bench_perf_close(struct bench_perf *pf)
+{
+	while (pf->num > 0)
+		close(pf->fd[--pf->num]);
+}
+
+int bench_mark_perf(struct bench *b, const struct bench_perf *pf, size_t reps,
+		int (*prep)(void *), int (*op)(void *), void *data)
+{
+	int rt = 0;
+	size_t r;
+
+	b->nanos = 0;
+	b->reps = 0;
+	b->nev = 0;
+	for (volatile size_t i = 0; i < REPS_INIT; i++) {
+		if (prep && (rt = prep(data)) != 0)
+			return rt;
+		if ((rt = op(data)) != 0)
+			return rt;
+	}
+
+	if (pf->num > 0)
+		ioctl(pf->fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	for (r = 0; r < reps; r++) {
+		if (prep && (rt = prep(data)) != 0)
+			break;
+		if (pf->num > 0)
+			ioctl(pf->fd[0], PERF_EVENT_IOC_ENABLE,
+				PERF_IOC_FLAG_GROUP);
+		rt = op(data);
+		if (pf->num > 0)
+			ioctl(pf->fd[0], PERF_EVENT_IOC_DISABLE,
+				PERF_IOC_FLAG_GROUP);
+		if (rt != 0)
+			break;
+	}
+	b->reps = r;
+	if (pf->num == 0 || r == 0)
+		return rt;
+
+	/* nr, time_enabled, time_running, values */
+	uint64_t buf[3 + BENCH_PERF_MAX];
+	const ssize_t len = (3 + pf->num) * sizeof *buf;
+	if (read(pf->fd[0], buf, len) != len || buf[0] != pf->num
+			|| buf[2] == 0)
+		return rt;
+
+	const double sc = (double)buf[1] / buf[2] / r;
+	for (size_t i = 0; i < pf->num; i++)
+		b->ev[i] = buf[3 + i] * sc;
+	b->nev = pf->num;
+	b->nanos = buf[1];
+
+	return rt;
+}
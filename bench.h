@@ -20,10 +20,17 @@
 #define BENCH_H
 
 #include <stddef.h>
+#include <stdint.h>
+
+/* Maximal number of hardware counters measured at once. */
+#define BENCH_PERF_MAX (8)
 
 struct bench {
 	unsigned long nanos;
 	size_t reps;
+	/* Counts of the events in struct bench_perf, per call to op */
+	size_t nev;
+	double ev[BENCH_PERF_MAX];
 };
 
 /* Measure the performance of the supplied function op and store
@@ -40,8 +47,86 @@ struct bench {
  * After the call, struct bench pointed to by b holds in b->reps the total
  * number of calls to op (excluding the cache warm-up calls), and b->nanos
  * holds the number of nanoseconds (measured by the PROCESS clock) that
- * passed between the first and the last call.
+ * passed between the first and the last call.  No counters are measured,
+ * and b->nev is set to 0.
  */
 int bench_mark(struct bench *b, size_t reps, int (*op)(void *), void *data);
 
+/* Performance event to be counted with perf_event_open(2).  The fields
+ * type and config are as in struct perf_event_attr, e.g. PERF_TYPE_RAW
+ * and a model-specific event code for uops dispatched to a given port.
+ */
+struct bench_event {
+	const char *name;
+	uint32_t type;
+	uint64_t config;
+};
+
+/* Cycles, instructions, L1D read misses and branch misses. */
+extern const struct bench_event BENCH_EVENTS_DEFAULT[];
+#define BENCH_EVENTS_DEFAULT_NUM (4)
+
+/* Group of open hardware counters. */
+struct bench_perf {
+	size_t num;
+	int fd[BENCH_PERF_MAX];
+	const char *name[BENCH_PERF_MAX];
+};
+
+/* Open a group of counters for the events ev[0], ..., ev[num-1] of the
+ * calling thread, in user space only.  Events that are not supported by
+ * the CPU are skipped.  If perf events are not permitted at all (see
+ * /proc/sys/kernel/perf_event_paranoid), no counter is opened.
+ *
+ * Returns the number of open counters, stored in pf->num.  This can be 0.
+ */
+size_t bench_perf_open(struct bench_perf *pf, const struct bench_event *ev,
+		size_t num);
+
+void bench_perf_close(struct bench_perf *pf);
+
+/* Just like bench_mark(), but count the events of the group pf.  The counters
+ * are enabled only for the duration of each call to op.  Before each call,
+ * the function prep is called outside of the measured region; prep can be
+ * nullptr.
+ *
+ * After the call, b->ev[i] holds the count of the event pf->name[i] per call
+ * to op, scaled up if the kernel had to multiplex the counters, and b->nanos
+ * holds the time the counters were enabled.  If pf has no open counters or
+ * the group could not be scheduled, b->nev is 0 and b->nanos is 0.
+ */
+int bench_mark_perf(struct bench *b, const struct bench_perf *pf, size_t reps,
+		int (*prep)(void *), int (*op)(void *), void *data);
+
+struct bench_stats {
+	size_t reps;
+	double mean;
+	uint64_t min, median, p99, max;
+};
+
+/* Measure the distribution of the time of a single call to op, in ticks
+ * of the CPU time-stamp counter (TSC).
+ *
+ * Before each call to op, the function prep is called with the same
+ * argument data, outside of the measured region.  It can be used to reset
+ * the input of op, if op modifies it.  The argument prep can be nullptr.
+ *
+ * The array samples must hold reps elements.  After the call, it holds
+ * the measured times, sorted.  The summary is stored in st.  The ticks
+ * include the cost of reading the TSC itself, see bench_tsc_overhead().
+ *
+ * Just like bench_mark(), the function warms the cache up first, and
+ * it returns the first non-zero value returned by prep or op.
+ */
+int bench_sample(struct bench_stats *st, uint64_t *samples, size_t reps,
+		int (*prep)(void *), int (*op)(void *), void *data);
+
+/* Return the frequency of the TSC in Hz, measured against the MONOTONIC
+ * clock.  The result is computed once and cached.
+ */
+double bench_tsc_hz(void);
+
+/* Return the median number of TSC ticks measured for an empty region. */
+uint64_t bench_tsc_overhead(void);
+
 #endif /* BENCH_H */
@@ -16,105 +16,1034 @@
  * You should have received a copy of the GNU General Public License along    *
  * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
  * -------------------------------------------------------------------------- */
+#define _XOPEN_SOURCE 700
+
+#include <inttypes.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <linux/perf_event.h>
 
 #include "bench.h"
 #include "ffge.h"
+#include "ffge_pack.h"
+#include "ffge_stats.h"
 #include "utils.h"
 #include "xoshiro256ss.h"
 
 #define SEED UINT64_C(9482110)
 static struct xoshiro256ss RNG;
 
-#define SIZE (12)
-static int64_t m[SIZE*SIZE];
-static alignas(64) int64_t m_i8[SIZE*SIZE * FFGE_WIDTH];
+/* Number of distinct inputs generated for each kernel and size.  Before
+ * each measured call, the next one is copied to the working buffer.
+ */
+#define POOL (64)
+#define REPS (4999UL)
+#define MAX_SIZES (32)
+#define SIZES_DEFAULT "4,8,12,16,24,32,64"
+
+/* Hardware counters, if requested and available */
+static struct bench_perf PERF = { .num = 0 };
+
+/* Kernel to measure.  Each call processes width matrices of size n x n,
+ * stored in a buffer of size(n) bytes.
+ */
+struct kernel {
+	const char *name;
+	size_t width;
+	size_t max_n;
+	size_t (*size)(size_t n);
+	void (*gen)(void *m, size_t n);
+	void (*run)(void *m, size_t n);
+};
 
-#define REPS (9999UL)
-static double bench_avgmicros(struct bench *b)
+static int64_t m[128 * 128];
+
+static size_t rand_rank(size_t n)
 {
-	return (double)b->nanos / b->reps / 1000L;
+	/* Generate random matrices: 50% full-rank, 50% singular. */
+	return (xoshiro256ss_next(&RNG) % 2) == 1 ?
+		n : xoshiro256ss_next(&RNG) % n;
 }
 
-static int genrand_mt(void *)
+static size_t size_prim(size_t n)
 {
-	/* Generate random matrices: 50% full-rank, 50% singular. */
-	size_t rnk = (xoshiro256ss_next(&RNG) % 2) == 1 ?
-		SIZE : xoshiro256ss_next(&RNG) % SIZE;
-	ffge_mat_genrand_prim(m, SIZE, rnk, 99, &RNG);
+	return n*n * sizeof(int64_t);
+}
 
-	return 0;
+static void gen_prim(void *a, size_t n)
+{
+	ffge_mat_genrand_prim(a, n, n, rand_rank(n), 99, &RNG);
+}
+
+static void run_ffge(void *a, size_t n)
+{
+	ffge(a, n, n);
+}
+
+static void run_ffge_prim(void *a, size_t n)
+{
+	ffge_prim(a, n, n);
+}
+
+static size_t size_prim_i8(size_t n)
+{
+	return n*n * FFGE_WIDTH * sizeof(int64_t);
+}
+
+static void gen_prim_i8(void *a, size_t n)
+{
+	int64_t *m_i8 = a;
+
+	for (size_t k = 0; k < FFGE_WIDTH; k++) {
+		ffge_mat_genrand_prim(m, n, n, rand_rank(n), 99, &RNG);
+		for (size_t i = 0; i < n*n; i++)
+			m_i8[i*FFGE_WIDTH + k] = m[i];
+	}
+}
+
+static void run_ffge_prim_i8(void *a, size_t n)
+{
+	ffge_prim_i8(a, n, n);
+}
+
+/* Single matrices submitted to the queue one at a time, dispatched in full
+ * groups.  Compare with ffge_prim_i8 for the cost of copying and packing.
+ */
+static struct ffge_queue *queue = nullptr;
+static size_t queue_n = 0;
+static alignas(64) int64_t w_queue[128 * 128 * FFGE_WIDTH];
+
+static void queue_fn(void *, bool, void *)
+{
+}
+
+static void gen_queue(void *a, size_t n)
+{
+	int64_t *m_q = a;
+
+	for (size_t k = 0; k < FFGE_WIDTH; k++)
+		ffge_mat_genrand_prim(m_q + k*n*n, n, n, rand_rank(n), 99,
+			&RNG);
+}
+
+static void run_ffge_queue(void *a, size_t n)
+{
+	const int64_t *m_q = a;
+
+	if (queue_n != n) {
+		ffge_queue_destroy(queue);
+		queue = ffge_queue_create(n, n, FFGE_WIDTH, UINT64_MAX,
+				queue_fn, nullptr);
+		queue_n = n;
+	}
+	for (size_t k = 0; k < FFGE_WIDTH; k++)
+		ffge_queue_submit(queue, m_q + k*n*n, nullptr);
+	ffge_queue_poll(queue, false, w_queue);
+}
+
+static void run_ffge_prim_i8_stop(void *a, size_t n)
+{
+	ffge_prim_i8_stop(a, n, n, 0xff);
+}
+
+static alignas(64) int64_t w_rank[128 * 128 * FFGE_WIDTH];
+
+static void run_ffge_prim_rank_i8(void *a, size_t n)
+{
+	ffge_prim_rank_i8(a, n, n, w_rank);
+}
+
+static size_t size_sym(size_t n)
+{
+	return FFGE_SYM_SIZE(n) * sizeof(int64_t);
+}
+
+/* Generate random symmetric matrices, stored as upper triangles. */
+static void gen_sym(void *a, size_t n)
+{
+	int64_t *m_sym = a;
+	size_t l = 0;
+
+	ffge_mat_genrand_sym(m, n, rand_rank(n), 99, &RNG);
+	for (size_t i = 0; i < n; i++)
+		for (size_t j = i; j < n; j++)
+			m_sym[l++] = m[i*n + j];
+}
+
+static void run_ffge_sym_prim(void *a, size_t n)
+{
+	ffge_sym_prim(a, n);
+}
+
+static size_t size_sym_i8(size_t n)
+{
+	return FFGE_SYM_SIZE(n) * FFGE_WIDTH * sizeof(int64_t);
+}
+
+static void gen_sym_i8(void *a, size_t n)
+{
+	int64_t *m_sym = a;
+
+	for (size_t k = 0; k < FFGE_WIDTH; k++) {
+		size_t l = 0;
+		ffge_mat_genrand_sym(m, n, rand_rank(n), 99, &RNG);
+		for (size_t i = 0; i < n; i++)
+			for (size_t j = i; j < n; j++)
+				m_sym[(l++)*FFGE_WIDTH + k] = m[i*n + j];
+	}
+}
+
+static void run_ffge_sym_prim_i8(void *a, size_t n)
+{
+	ffge_sym_prim_i8(a, n);
+}
+
+static size_t size_prim16_i32(size_t n)
+{
+	return n*n * FFGE_WIDTH16 * sizeof(uint16_t);
+}
+
+static void gen_prim16_i32(void *a, size_t n)
+{
+	uint16_t *m_i32 = a;
+
+	for (size_t k = 0; k < FFGE_WIDTH16; k++) {
+		ffge_mat_genrand_prim(m, n, n, rand_rank(n), 99, &RNG);
+		for (size_t i = 0; i < n*n; i++) {
+			const int64_t x = m[i] % FFGE_PRIM16;
+			m_i32[i*FFGE_WIDTH16 + k] = x < 0 ? x + FFGE_PRIM16 : x;
+		}
+	}
+}
+
+static void run_ffge_prim16_i32(void *a, size_t n)
+{
+	ffge_prim16_i32(a, n, n);
+}
+
+static alignas(64) int64_t w_screen[FFGE_SCREEN_WORK(128, 128)];
+
+static size_t size_screen_i32(size_t n)
+{
+	return n*n * FFGE_WIDTH16 * sizeof(int64_t);
+}
+
+static void gen_screen_i32(void *a, size_t n)
+{
+	for (size_t b = 0; b < FFGE_WIDTH16 / FFGE_WIDTH; b++)
+		gen_prim_i8((int64_t *)a + b*n*n*FFGE_WIDTH, n);
+}
+
+static void run_ffge_screen_i32(void *a, size_t n)
+{
+	ffge_screen_i32(a, n, n, true, w_screen, nullptr);
+}
+
+static void run_ffge_screen_i32_fast(void *a, size_t n)
+{
+	ffge_screen_i32(a, n, n, false, w_screen, nullptr);
+}
+
+static size_t size_gf2(size_t n)
+{
+	return n * FFGE_GF2_STRIDE(n) * sizeof(uint64_t);
+}
+
+/* Generate random matrices over GF(2), uniformly. */
+static void gen_gf2(void *a, size_t n)
+{
+	const size_t st = FFGE_GF2_STRIDE(n);
+	uint64_t *m_gf2 = a;
+
+	for (size_t i = 0; i < n; i++)
+		for (size_t j = 0; j < st; j++) {
+			uint64_t x = j*64 < n ? xoshiro256ss_next(&RNG) : 0;
+			if (j == n/64 && n % 64)
+				x &= (UINT64_C(1) << n % 64) - 1;
+			m_gf2[i*st + j] = x;
+		}
 }
 
-static int rank12(void *)
+static void run_ffge_gf2(void *a, size_t n)
 {
-	genrand_mt(nullptr);
-	ffge(m, SIZE);
+	ffge_gf2(a, n, n);
+}
+
+static size_t size_gf2_i8(size_t n)
+{
+	return n * FFGE_WIDTH * sizeof(uint64_t);
+}
+
+static void gen_gf2_i8(void *a, size_t n)
+{
+	const uint64_t mask = n < 64 ? (UINT64_C(1) << n) - 1 : ~UINT64_C(0);
+	uint64_t *m_gf2_i8 = a;
+
+	for (size_t i = 0; i < n * FFGE_WIDTH; i++)
+		m_gf2_i8[i] = xoshiro256ss_next(&RNG) & mask;
+}
+
+static void run_ffge_gf2_i8(void *a, size_t n)
+{
+	ffge_gf2_i8(a, n, n);
+}
+
+static const struct kernel KERNELS[] = {
+	{ "ffge", 1, 0, size_prim, gen_prim, run_ffge },
+	{ "ffge_prim", 1, 0, size_prim, gen_prim, run_ffge_prim },
+	{ "ffge_prim_i8", FFGE_WIDTH, 0,
+		size_prim_i8, gen_prim_i8, run_ffge_prim_i8 },
+	{ "ffge_sym_prim", 1, 0, size_sym, gen_sym, run_ffge_sym_prim },
+	{ "ffge_sym_prim_i8", FFGE_WIDTH, 0,
+		size_sym_i8, gen_sym_i8, run_ffge_sym_prim_i8 },
+	{ "ffge_prim_i8_stop", FFGE_WIDTH, 0,
+		size_prim_i8, gen_prim_i8, run_ffge_prim_i8_stop },
+	{ "ffge_prim_rank_i8", FFGE_WIDTH, 0,
+		size_prim_i8, gen_prim_i8, run_ffge_prim_rank_i8 },
+	{ "ffge_queue", FFGE_WIDTH, 0,
+		size_prim_i8, gen_queue, run_ffge_queue },
+	{ "ffge_prim16_i32", FFGE_WIDTH16, 0,
+		size_prim16_i32, gen_prim16_i32, run_ffge_prim16_i32 },
+	{ "ffge_screen_i32", FFGE_WIDTH16, 0,
+		size_screen_i32, gen_screen_i32, run_ffge_screen_i32 },
+	{ "ffge_screen_i32_fast", FFGE_WIDTH16, 0,
+		size_screen_i32, gen_screen_i32, run_ffge_screen_i32_fast },
+	{ "ffge_gf2", 1, 0, size_gf2, gen_gf2, run_ffge_gf2 },
+	{ "ffge_gf2_i8", FFGE_WIDTH, 64,
+		size_gf2_i8, gen_gf2_i8, run_ffge_gf2_i8 },
+};
+#define NUM_KERNELS (sizeof KERNELS / sizeof *KERNELS)
+
+/* State of the measurement of one kernel at one size. */
+struct point {
+	const struct kernel *k;
+	size_t n, sz, idx;
+	unsigned char *pool, *work;
+};
+
+static int point_prep(void *data)
+{
+	struct point *pt = data;
+
+	memcpy(pt->work, pt->pool + pt->idx * pt->sz, pt->sz);
+	pt->idx = (pt->idx + 1) % POOL;
 
 	return 0;
 }
 
-static int rank12_prim(void *)
+static int point_run(void *data)
 {
-	genrand_mt(nullptr);
-	ffge_prim(m, SIZE);
+	struct point *pt = data;
+
+	pt->k->run(pt->work, pt->n);
 
 	return 0;
 }
 
-static int genrand_mt_i8(void *)
+struct result {
+	const char *kernel;
+	size_t n, width, reps;
+	double ns_mean, ns_median, ns_p99;
+	double ns_per_mat, cyc_per_elem, mats_per_sec;
+	/* counts of the events in PERF per call */
+	size_t nev;
+	double ev[BENCH_PERF_MAX];
+};
+
+static void result_fill(struct result *r, const struct point *pt,
+			const struct bench_stats *st)
 {
-	/* Generate random matrices: 50% full-rank, 50% singular. */
-	for (size_t k = 0; k < FFGE_WIDTH; k++) {
-		genrand_mt(nullptr);
-		for (size_t i = 0; i < SIZE; i++)
-			for (size_t j = 0; j < SIZE; j++)
-				m_i8[(i*SIZE + j)*FFGE_WIDTH + k] =
-					m[i*SIZE + j];
+	const double ns = 1.0e9 / bench_tsc_hz();
+	const double w = pt->k->width;
+
+	r->kernel = pt->k->name;
+	r->n = pt->n;
+	r->width = pt->k->width;
+	r->reps = st->reps;
+	r->ns_mean = st->mean * ns;
+	r->ns_median = st->median * ns;
+	r->ns_p99 = st->p99 * ns;
+	r->ns_per_mat = r->ns_median / w;
+	r->cyc_per_elem = st->median / (w * pt->n * pt->n);
+	r->mats_per_sec = w * 1.0e9 / r->ns_median;
+}
+
+static int measure(struct result *r, const struct kernel *k, size_t n,
+			uint64_t *samples, size_t reps)
+{
+	struct point pt = { .k = k, .n = n, .idx = 0 };
+	struct bench_stats st;
+	int rt = -1;
+
+	pt.sz = (k->size(n) + 63) / 64 * 64;
+	pt.pool = aligned_alloc(64, pt.sz * POOL);
+	pt.work = aligned_alloc(64, pt.sz);
+	if (!pt.pool || !pt.work)
+		goto err;
+
+	/* Inputs are generated here, outside of the measured region */
+	for (size_t i = 0; i < POOL; i++)
+		k->gen(pt.pool + i * pt.sz, n);
+
+	if ((rt = bench_sample(&st, samples, reps,
+			point_prep, point_run, &pt)) != 0)
+		goto err;
+	result_fill(r, &pt, &st);
+
+	r->nev = 0;
+	if (PERF.num > 0) {
+		struct bench b;
+		if ((rt = bench_mark_perf(&b, &PERF, reps,
+				point_prep, point_run, &pt)) != 0)
+			goto err;
+		r->nev = b.nev;
+		for (size_t i = 0; i < b.nev; i++)
+			r->ev[i] = b.ev[i];
+	}
+err:
+	free(pt.pool);
+	free(pt.work);
+
+	return rt;
+}
+
+static void print_text_header(void)
+{
+	printf("# tsc: %.3f GHz, overhead: %lu ticks per sample\n",
+		bench_tsc_hz() / 1.0e9, (unsigned long)bench_tsc_overhead());
+	printf("%-20s %4s %10s %10s %10s %10s %12s\n", "kernel", "n",
+		"ns/mat", "ns/call", "p99/call", "cyc/elem", "mat/s");
+}
+
+static void print_text(const struct result *r)
+{
+	printf("%-20s %4zu %10.1f %10.1f %10.1f %10.3f %12.0f\n",
+		r->kernel, r->n, r->ns_per_mat, r->ns_median, r->ns_p99,
+		r->cyc_per_elem, r->mats_per_sec);
+	for (size_t i = 0; i < r->nev; i++)
+		printf("%s%s: %.1f", i == 0 ? "  per call: " : ", ",
+			PERF.name[i], r->ev[i]);
+	if (r->nev > 0)
+		printf("\n");
+}
+
+/* Print s as a JSON string, escaping quotes, backslashes and controls. */
+static void print_json_string(const char *s)
+{
+	putchar('"');
+	for (; *s; s++) {
+		const unsigned char c = *s;
+		if (c == '"' || c == '\\')
+			printf("\\%c", c);
+		else if (c < 0x20)
+			printf("\\u%04x", c);
+		else
+			putchar(c);
+	}
+	putchar('"');
+}
+
+static void print_json_header(const char *label)
+{
+	printf("{\n");
+	printf("  \"label\": ");
+	print_json_string(label);
+	printf(",\n");
+	printf("  \"compiler\": ");
+	print_json_string(__VERSION__);
+	printf(",\n");
+	printf("  \"tsc_hz\": %.0f,\n", bench_tsc_hz());
+	printf("  \"tsc_overhead\": %lu,\n",
+		(unsigned long)bench_tsc_overhead());
+	printf("  \"results\": [");
+}
+
+static void print_json(const struct result *r, bool first)
+{
+	printf("%s\n    { \"kernel\": \"%s\", \"n\": %zu, \"width\": %zu, "
+		"\"reps\": %zu,\n", first ? "" : ",",
+		r->kernel, r->n, r->width, r->reps);
+	printf("      \"ns_per_matrix\": %.3f, \"ns_mean\": %.3f, "
+		"\"ns_median\": %.3f, \"ns_p99\": %.3f,\n",
+		r->ns_per_mat, r->ns_mean, r->ns_median, r->ns_p99);
+	printf("      \"cycles_per_element\": %.4f, "
+		"\"matrices_per_s\": %.1f",
+		r->cyc_per_elem, r->mats_per_sec);
+	for (size_t i = 0; i < r->nev; i++)
+		printf("%s\"%s\": %.3f", i == 0 ?
+			",\n      \"counters_per_call\": { " : ", ",
+			PERF.name[i], r->ev[i]);
+	printf("%s }", r->nev > 0 ? " }" : "");
+}
+
+static void print_json_footer(void)
+{
+	printf("\n  ]\n}\n");
+}
+
+/* Sparse mode (-s): large sparse matrices, one per size, with a few
+ * non-zero elements per row.  The rank is computed by ffge_sparse_rank()
+ * with and without the switch to a dense kernel, by ffge_wiedemann_rank()
+ * with a thread per CPU, and by ffge_prim() on the dense matrix, up to
+ * SPARSE_DENSE_MAX.
+ */
+#define SPARSE_SIZES_DEFAULT "256,512,1024,2048,4096"
+#define SPARSE_MAX_SIZE (1UL << 16)
+#define SPARSE_DENSE_MAX (1024)
+#define SPARSE_PER_ROW (4)
+#define SPARSE_REPS (5UL)
+
+struct sparse_point {
+	size_t n, nnz;
+	size_t *rp, *ci;
+	int64_t *v;
+	int64_t *a, *work;	/* dense matrix, or nullptr */
+	double dense;
+	size_t threads;
+	size_t rank;
+	struct ffge_sparse_stats st;
+};
+
+enum {
+	SPARSE_SPARSE,
+	SPARSE_HYBRID,
+	SPARSE_WIEDEMANN,
+	SPARSE_DENSE,
+	SPARSE_KERNELS
+};
+
+/* Generate a random n x n matrix with the diagonal and up to
+ * SPARSE_PER_ROW - 1 other non-zero elements in each row.
+ */
+static int sparse_gen(struct sparse_point *sp, size_t n)
+{
+	sp->n = n;
+	sp->rp = malloc((n + 1) * sizeof *sp->rp);
+	sp->ci = malloc(n * SPARSE_PER_ROW * sizeof *sp->ci);
+	sp->v = malloc(n * SPARSE_PER_ROW * sizeof *sp->v);
+	sp->a = sp->work = nullptr;
+	if (n <= SPARSE_DENSE_MAX) {
+		sp->a = calloc(n * n, sizeof *sp->a);
+		sp->work = malloc(n * n * sizeof *sp->work);
+	}
+	if (!sp->rp || !sp->ci || !sp->v ||
+			(n <= SPARSE_DENSE_MAX && (!sp->a || !sp->work)))
+		return -1;
+
+	size_t l = 0;
+	for (size_t i = 0; i < n; i++) {
+		size_t c[SPARSE_PER_ROW], nc = 0;
+		c[nc++] = i;
+		for (size_t k = 1; k < SPARSE_PER_ROW; k++)
+			c[nc++] = xoshiro256ss_next(&RNG) % n;
+		for (size_t k = 1; k < nc; k++)	/* insertion sort */
+			for (size_t j = k; j > 0 && c[j - 1] > c[j]; j--) {
+				const size_t t = c[j];
+				c[j] = c[j - 1];
+				c[j - 1] = t;
+			}
+		sp->rp[i] = l;
+		for (size_t k = 0; k < nc; k++) {
+			if (k > 0 && c[k] == c[k - 1])
+				continue;
+			sp->ci[l] = c[k];
+			sp->v[l] = xoshiro256ss_next(&RNG) %
+				(FFGE_PRIM - 1) + 1;
+			if (sp->a)
+				sp->a[i*n + c[k]] = sp->v[l];
+			l++;
+		}
 	}
+	sp->rp[n] = sp->nnz = l;
 
 	return 0;
 }
 
-static int rank12_prim_i8(void *)
+static void sparse_free(struct sparse_point *sp)
+{
+	free(sp->rp);
+	free(sp->ci);
+	free(sp->v);
+	free(sp->a);
+	free(sp->work);
+}
+
+static int sparse_run(void *data)
+{
+	struct sparse_point *sp = data;
+
+	sp->rank = ffge_sparse_rank(sp->rp, sp->ci, sp->v, sp->n, sp->n,
+		sp->dense, &sp->st);
+
+	return sp->rank == SIZE_MAX ? -1 : 0;
+}
+
+static int sparse_run_wiedemann(void *data)
+{
+	struct sparse_point *sp = data;
+
+	sp->rank = ffge_wiedemann_rank(sp->rp, sp->ci, sp->v, sp->n, sp->n,
+		sp->threads, SEED, nullptr);
+
+	return sp->rank == SIZE_MAX ? -1 : 0;
+}
+
+static int sparse_prep_dense(void *data)
 {
-	genrand_mt_i8(nullptr);
-	ffge_prim_i8(m_i8, SIZE);
+	struct sparse_point *sp = data;
+
+	memcpy(sp->work, sp->a, sp->n * sp->n * sizeof *sp->a);
 
 	return 0;
 }
 
-int main(int, char **)
+static int sparse_run_dense(void *data)
 {
-	xoshiro256ss_init(&RNG, SEED);
+	struct sparse_point *sp = data;
 
-	double t_genrand, t_genrand_i8;
-	struct bench b;
+	sp->rank = ffge_prim(sp->work, sp->n, sp->n);
+
+	return 0;
+}
 
-	bench_mark(&b, REPS, genrand_mt, nullptr);
-	t_genrand = bench_avgmicros(&b);
-	printf("genrand_mt:      %.3f μs\n", t_genrand);
+static int sparse_measure(size_t n, uint64_t *samples, size_t reps,
+		bool json, bool *first)
+{
+	static const char *const names[SPARSE_KERNELS] = {
+		"sparse", "hybrid", "wiedemann", "dense"
+	};
+	static int (*const prep[SPARSE_KERNELS])(void *) = {
+		[SPARSE_DENSE] = sparse_prep_dense
+	};
+	static int (*const run[SPARSE_KERNELS])(void *) = {
+		sparse_run, sparse_run, sparse_run_wiedemann, sparse_run_dense
+	};
+	struct sparse_point sp;
+	int rt = -1;
 
-	bench_mark(&b, REPS, rank12, nullptr);
-	printf("rank12:          %.3f μs", bench_avgmicros(&b));
-	printf(" (excl. genrand_mt: %.3f μs)\n",
-				 bench_avgmicros(&b) - t_genrand);
+	if (sparse_gen(&sp, n) < 0)
+		goto err;
+	const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	sp.threads = cpus > 0 ? cpus : 1;
+	for (size_t i = 0; i < SPARSE_KERNELS; i++) {
+		struct bench_stats st;
+		size_t mem;
 
-	bench_mark(&b, REPS, rank12_prim, nullptr);
-	printf("rank12_prim:     %.3f μs", bench_avgmicros(&b));
-	printf(" (excl. genrand_mt: %.3f μs)\n",
-				 bench_avgmicros(&b) - t_genrand);
+		if (i == SPARSE_DENSE && !sp.a)
+			break;
+		sp.dense = i == SPARSE_SPARSE ? 2.0 : FFGE_SPARSE_DENSE;
+		sp.st = (struct ffge_sparse_stats){ 0 };
+		if ((rt = bench_sample(&st, samples, reps,
+				prep[i], run[i], &sp)) != 0)
+			goto err;
 
-	bench_mark(&b, REPS, genrand_mt_i8, nullptr);
-	t_genrand_i8 = bench_avgmicros(&b);
-	printf("genrand_mt_i8:   %.3f μs\n", t_genrand_i8);
+		/* Stored elements at the peak; for ffge_wiedemann_rank(), two
+		 * copies of the matrix, 8 lanes of 4 vectors and of the
+		 * sequence, and 3 polynomials of Berlekamp-Massey per lane.
+		 */
+		if (i == SPARSE_DENSE)
+			mem = n * n * sizeof *sp.a;
+		else if (i == SPARSE_WIEDEMANN)
+			mem = 2 * sp.nnz * (sizeof *sp.ci + sizeof *sp.v) +
+				(4 * n + 2 * (n + 1) + 3 * (n + 3)) *
+					FFGE_WIDTH * sizeof *sp.v;
+		else
+			mem = sp.st.nnz_peak * (sizeof *sp.ci + sizeof *sp.v) +
+				sp.st.dense_nr * sp.st.dense_nc * sizeof *sp.v;
+		const double ms = st.median * 1.0e3 / bench_tsc_hz();
+		if (json)
+			printf("%s\n    { \"kernel\": \"%s\", \"n\": %zu, "
+				"\"nnz\": %zu, \"reps\": %zu, \"rank\": %zu,\n"
+				"      \"ms_median\": %.3f, \"bytes\": %zu, "
+				"\"fill\": %" PRIu64 ", \"dense_n\": %" PRIu64
+				" }", *first ? "" : ",", names[i], n, sp.nnz,
+				st.reps, sp.rank, ms, mem, sp.st.fill,
+				sp.st.dense_nr);
+		else
+			printf("%-10s %6zu %8zu %6zu %12.3f %12.1f %10" PRIu64
+				" %8" PRIu64 "\n", names[i], n, sp.nnz,
+				sp.rank, ms, mem / 1024.0, sp.st.fill,
+				sp.st.dense_nr);
+		*first = false;
+		fflush(stdout);
+	}
+	rt = 0;
+err:
+	sparse_free(&sp);
 
-	bench_mark(&b, REPS, rank12_prim_i8, nullptr);
-	printf("rank12_prim_i8:  %.3f μs", bench_avgmicros(&b));
-	printf(" (excl. genrand_mt_i8, avg.: %.3f μs)\n",
-		(bench_avgmicros(&b) - t_genrand_i8) / FFGE_WIDTH);
+	return rt;
+}
+
+static void sparse_print_text_header(void)
+{
+	printf("%-10s %6s %8s %6s %12s %12s %10s %8s\n", "kernel", "n", "nnz",
+		"rank", "ms", "KiB", "fill", "dense_n");
+}
+
+/* Pipeline mode (-P): PIPE_COUNT matrices of each size, copied from a pool
+ * of inputs, are ranked in groups of FFGE_WIDTH one step after another on a
+ * single thread, and by ffge_pipe_run() with its stages spread over the
+ * CPUs, if there is more than one.
+ */
+#define PIPE_COUNT (1UL << 15)
+#define PIPE_GROUPS (2 * FFGE_PIPE_STAGES)
+
+struct pipe_point {
+	size_t n, i;
+	const int64_t *pool;
+	size_t full;
+};
+
+static bool pipe_gen(int64_t *m, void **tag, void *data)
+{
+	struct pipe_point *pt = data;
+	const size_t ne = pt->n * pt->n;
+
+	if (pt->i == PIPE_COUNT)
+		return false;
+	memcpy(m, pt->pool + (pt->i++ % POOL) * ne, ne * sizeof *m);
+	*tag = nullptr;
+
+	return true;
+}
+
+static void pipe_collect(void *, bool full_rank, void *data)
+{
+	struct pipe_point *pt = data;
+
+	pt->full += full_rank;
+}
+
+/* The same steps as ffge_pipe_run(), one after another. */
+static int pipe_serial(struct pipe_point *pt, uint64_t *ns)
+{
+	const size_t n = pt->n, ne = n * n;
+	int64_t *m = malloc(FFGE_WIDTH * ne * sizeof *m);
+	int64_t *p = aligned_alloc(64, FFGE_WIDTH * ne * sizeof *p);
+	void *tag[FFGE_WIDTH];
+
+	if (!m || !p) {
+		free(m);
+		free(p);
+		return -1;
+	}
+	const uint64_t t0 = ffge_stats_now();
+	for (bool more = true; more; ) {
+		size_t k = 0;
+		while (k < FFGE_WIDTH && (more = pipe_gen(m + k * ne,
+				tag + k, pt)))
+			k++;
+		for (size_t l = 0; l < FFGE_WIDTH; l++)
+			ffge_pack_lane(p, l, n, n, m + l * ne,
+				l < k ? n : 0, n);
+		const uint8_t fl = ffge_prim_i8(p, n, n);
+		for (size_t l = 0; l < k; l++)
+			pipe_collect(tag[l], (fl >> l) & 1, pt);
+	}
+	*ns = ffge_stats_now() - t0;
+	free(m);
+	free(p);
 
 	return 0;
 }
+
+static int pipe_measure(size_t n, bool json, bool *first)
+{
+	static const char *const stages[FFGE_PIPE_STAGES] = {
+		"generate", "pack", "eliminate", "collect"
+	};
+	struct pipe_point pt = { .n = n };
+	struct ffge_pipe_stats st;
+	int cpu[FFGE_PIPE_STAGES];
+	uint64_t ns_serial;
+	int rt = -1;
+
+	int64_t *pool = malloc(POOL * n * n * sizeof *pool);
+	if (!pool)
+		return -1;
+	for (size_t i = 0; i < POOL; i++)
+		gen_prim(pool + i * n * n, n);
+	pt.pool = pool;
+
+	const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	for (size_t s = 0; s < FFGE_PIPE_STAGES; s++)
+		cpu[s] = cpus > 1 ? (int)(s % cpus) : -1;
+
+	if (pipe_serial(&pt, &ns_serial) < 0)
+		goto err;
+	const size_t full = pt.full;
+	pt.i = pt.full = 0;
+	if (ffge_pipe_run(n, n, PIPE_GROUPS, cpu, pipe_gen, pipe_collect,
+			&pt, &st) < 0 || pt.full != full)
+		goto err;
+
+	const double mps_serial = PIPE_COUNT * 1.0e9 / ns_serial;
+	const double mps_pipe = PIPE_COUNT * 1.0e9 / st.ns;
+	if (json) {
+		printf("%s\n    { \"n\": %zu, \"matrices\": %lu, "
+			"\"serial_matrices_per_s\": %.1f, "
+			"\"pipe_matrices_per_s\": %.1f,\n      \"stages\": [",
+			*first ? "" : ",", n, PIPE_COUNT, mps_serial,
+			mps_pipe);
+		for (size_t s = 0; s < FFGE_PIPE_STAGES; s++)
+			printf("%s\n        { \"stage\": \"%s\", \"cpu\": %d, "
+				"\"occupancy\": %.4f, \"wait_ns\": %" PRIu64
+				", \"mean_depth\": %.3f }", s ? "," : "",
+				stages[s], cpu[s],
+				(double)st.stage[s].busy_ns / st.ns,
+				st.stage[s].wait_ns,
+				(double)st.stage[s].depth /
+					st.stage[s].groups);
+		printf(" ] }");
+	} else {
+		printf("%4zu %12.0f %12.0f", n, mps_serial, mps_pipe);
+		for (size_t s = 0; s < FFGE_PIPE_STAGES; s++)
+			printf(" %9.1f%%", 100.0 * st.stage[s].busy_ns / st.ns);
+		printf("\n");
+	}
+	*first = false;
+	fflush(stdout);
+	rt = 0;
+err:
+	free(pool);
+
+	return rt;
+}
+
+static void pipe_print_text_header(void)
+{
+	printf("# occupancy of the stages: the fraction of time busy\n");
+	printf("%4s %12s %12s %10s %10s %10s %10s\n", "n", "serial/s",
+		"pipe/s", "generate", "pack", "eliminate", "collect");
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-j] [-l label] [-n sizes] [-k kernels] "
+		"[-r reps] [-p] [-e name=code]... [-s | -P]\n\n", prog);
+	fprintf(stderr, "  -j          print the results as JSON\n");
+	fprintf(stderr, "  -l label    label of the run, e.g. a version\n");
+	fprintf(stderr, "  -n sizes    comma-separated list of sizes "
+		"(default: %s)\n", SIZES_DEFAULT);
+	fprintf(stderr, "  -k kernels  comma-separated list of kernels "
+		"(default: all)\n");
+	fprintf(stderr, "  -r reps     number of samples (default: %lu)\n",
+		REPS);
+	fprintf(stderr, "  -p          count cycles, instructions, "
+		"L1D and branch misses\n");
+	fprintf(stderr, "  -e name=code\n"
+		"              count also a raw, model-specific event, "
+		"e.g. -e p0=0x01a1\n");
+	fprintf(stderr, "  -s          sparse mode: time ffge_sparse_rank() "
+		"and ffge_wiedemann_rank()\n"
+		"              against ffge_prim()\n"
+		"              (default sizes: %s, reps: %lu)\n",
+		SPARSE_SIZES_DEFAULT, SPARSE_REPS);
+	fprintf(stderr, "  -P          pipeline mode: time ffge_pipe_run() "
+		"against the same steps\n"
+		"              on a single thread\n");
+	fprintf(stderr, "\nkernels:");
+	for (size_t i = 0; i < NUM_KERNELS; i++)
+		fprintf(stderr, " %s", KERNELS[i].name);
+	fprintf(stderr, "\n");
+}
+
+/* Parse a comma-separated list of sizes, at most max.  Returns the number
+ * of sizes, or 0 on error.
+ */
+static size_t parse_sizes(char *s, size_t *ns, size_t max)
+{
+	size_t num = 0;
+
+	for (char *t = strtok(s, ","); t; t = strtok(nullptr, ",")) {
+		char *end;
+		const unsigned long n = strtoul(t, &end, 10);
+		if (*end != '\0' || n == 0 || n > max || num == MAX_SIZES)
+			return 0;
+		ns[num++] = n;
+	}
+
+	return num;
+}
+
+/* Parse a raw event given as name=code, with code in hexadecimal.
+ * Returns 0 on success, or -1 on error.
+ */
+static int parse_event(char *s, struct bench_event *ev)
+{
+	char *eq = strchr(s, '='), *end;
+
+	if (!eq || eq == s)
+		return -1;
+	*eq = '\0';
+	ev->name = s;
+	ev->type = PERF_TYPE_RAW;
+	ev->config = strtoull(eq + 1, &end, 16);
+
+	return *end == '\0' && end != eq + 1 ? 0 : -1;
+}
+
+/* Mark the kernels named in a comma-separated list.  Returns 0 on success,
+ * or -1 if a name is unknown.
+ */
+static int parse_kernels(char *s, bool *sel)
+{
+	for (char *t = strtok(s, ","); t; t = strtok(nullptr, ",")) {
+		size_t i;
+		for (i = 0; i < NUM_KERNELS; i++)
+			if (strcmp(t, KERNELS[i].name) == 0)
+				break;
+		if (i == NUM_KERNELS)
+			return -1;
+		sel[i] = true;
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	char sizes[] = SIZES_DEFAULT, sizes_sparse[] = SPARSE_SIZES_DEFAULT;
+	char *sz = nullptr;
+	const char *label = "";
+	size_t ns[MAX_SIZES], num_ns, reps = 0;
+	bool json = false, sel[NUM_KERNELS] = { 0 }, any = false;
+	struct bench_event evs[BENCH_PERF_MAX];
+	size_t num_evs = 0;
+	bool perf = false, sparse = false, pipe = false;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "jl:n:k:r:pe:sPh")) != -1) {
+		switch (opt) {
+		case 'j':
+			json = true;
+			break;
+		case 'l':
+			label = optarg;
+			break;
+		case 'n':
+			sz = optarg;
+			break;
+		case 'k':
+			if (parse_kernels(optarg, sel) < 0) {
+				fprintf(stderr, "unknown kernel\n");
+				return 1;
+			}
+			break;
+		case 'r':
+			if ((reps = strtoul(optarg, nullptr, 10)) == 0) {
+				fprintf(stderr, "invalid number of reps\n");
+				return 1;
+			}
+			break;
+		case 'p':
+			perf = true;
+			break;
+		case 'e':
+			if (num_evs + BENCH_EVENTS_DEFAULT_NUM
+					== BENCH_PERF_MAX ||
+				parse_event(optarg, evs + num_evs) < 0) {
+				fprintf(stderr, "invalid event\n");
+				return 1;
+			}
+			num_evs++;
+			break;
+		case 's':
+			sparse = true;
+			break;
+		case 'P':
+			pipe = true;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+	if (!sz)
+		sz = sparse ? sizes_sparse : sizes;
+	if ((num_ns = parse_sizes(sz, ns,
+			sparse ? SPARSE_MAX_SIZE : 128)) == 0) {
+		fprintf(stderr, "invalid sizes\n");
+		return 1;
+	}
+	if (reps == 0)
+		reps = sparse ? SPARSE_REPS : REPS;
+	for (size_t i = 0; i < NUM_KERNELS; i++)
+		any |= sel[i];
+	if (!any)
+		for (size_t i = 0; i < NUM_KERNELS; i++)
+			sel[i] = true;
+
+	if (perf || num_evs > 0) {
+		struct bench_event ev[BENCH_PERF_MAX];
+		size_t num = 0;
+		for (size_t i = 0; perf && i < BENCH_EVENTS_DEFAULT_NUM; i++)
+			ev[num++] = BENCH_EVENTS_DEFAULT[i];
+		for (size_t i = 0; i < num_evs; i++)
+			ev[num++] = evs[i];
+		if (bench_perf_open(&PERF, ev, num) < num)
+			fprintf(stderr, "warning: %zu of %zu events not "
+				"available\n", num - PERF.num, num);
+	}
+
+	uint64_t *samples = malloc(reps * sizeof *samples);
+	if (!samples)
+		return 1;
+	xoshiro256ss_init(&RNG, SEED);
+
+	if (json)
+		print_json_header(label);
+	else if (sparse)
+		sparse_print_text_header();
+	else if (pipe)
+		pipe_print_text_header();
+	else
+		print_text_header();
+
+	bool first = true;
+	int rt = 0;
+	if (sparse) {
+		for (size_t j = 0; j < num_ns; j++)
+			if ((rt = sparse_measure(ns[j], samples, reps, json,
+					&first)) != 0)
+				goto out;
+		goto out;
+	}
+	if (pipe) {
+		for (size_t j = 0; j < num_ns; j++)
+			if ((rt = pipe_measure(ns[j], json, &first)) != 0)
+				goto out;
+		goto out;
+	}
+	for (size_t i = 0; i < NUM_KERNELS; i++) {
+		if (!sel[i])
+			continue;
+		for (size_t j = 0; j < num_ns; j++) {
+			const struct kernel *k = KERNELS + i;
+			struct result r;
+			if (k->max_n > 0 && ns[j] > k->max_n)
+				continue;
+			if ((rt = measure(&r, k, ns[j], samples, reps)) != 0)
+				goto out;
+
+			if (json)
+				print_json(&r, first);
+			else
+				print_text(&r);
+			first = false;
+			fflush(stdout);
+		}
+	}
+out:
+	if (json)
+		print_json_footer();
+	free(samples);
+	bench_perf_close(&PERF);
+
+	return rt != 0;
+}
@@ -0,0 +1,175 @@
+/* -------------------------------------------------------------------------- *
+ * ffge-rank.c: Compute ranks of a batch of matrices stored in a file.        *
+ *                                                                            *
+ * Copyright 2024 Marek Miller & ⧉⧉⧉                                          *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ffge.h"
+
+/* Size of the window of the input read ahead, and released behind */
+#define WINDOW (UINT64_C(64) << 20)
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-r] input output\n\n", prog);
+	fprintf(stderr, "Decide which matrices of the batch file input "
+		"have full rank modulo\n2^31-1.  Write a bitset to output: "
+		"bit i%%8 of byte i/8 is set if\nthe i-th matrix has full "
+		"rank.\n\n");
+	fprintf(stderr, "  -r    write the ranks instead, "
+		"as 32-bit unsigned integers\n");
+}
+
+static int write_all(const char *path, const void *buf, size_t len)
+{
+	FILE *f = fopen(path, "wb");
+	if (!f)
+		return -1;
+
+	const size_t rt = fwrite(buf, 1, len, f);
+	if (fclose(f) != 0 || rt != len)
+		return -1;
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	bool ranks = false;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "rh")) != -1) {
+		switch (opt) {
+		case 'r':
+			ranks = true;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+	if (argc - optind != 2) {
+		usage(argv[0]);
+		return 1;
+	}
+	const char *in = argv[optind], *out = argv[optind + 1];
+
+	const int fd = open(in, O_RDONLY);
+	struct stat sb;
+	if (fd < 0 || fstat(fd, &sb) < 0) {
+		perror(in);
+		return 1;
+	}
+	const size_t len = sb.st_size;
+	if (len < sizeof(struct ffge_batch)) {
+		fprintf(stderr, "%s: not a batch file\n", in);
+		return 1;
+	}
+
+	/* The mapping is read-only: the full-rank flags are computed by
+	 * ffge_prim_rank_i8(), which leaves its input intact, so a packed
+	 * group is never copied.  The ranks need the in-place kernel, which
+	 * gets a copy of each group in the arena.
+	 */
+	unsigned char *map = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
+		perror(in);
+		return 1;
+	}
+	const struct ffge_batch h = *(struct ffge_batch *)map;
+	const size_t sz = ffge_batch_size(&h);
+	if (sz == 0 || sz > len - sizeof h) {
+		fprintf(stderr, "%s: invalid header\n", in);
+		return 1;
+	}
+	unsigned char *p = map + sizeof h;
+	madvise(map, len, MADV_SEQUENTIAL);
+
+	const size_t nr = h.nr, nc = h.nc, ne = nr * nc;
+	const size_t ng = (h.count + FFGE_WIDTH - 1) / FFGE_WIDTH;
+	const size_t gs = h.layout == FFGE_BATCH_PACKED ?
+		ne * FFGE_WIDTH * sizeof(int64_t) : ne * h.width * FFGE_WIDTH;
+
+	struct ffge_arena *ar = ffge_arena_create(
+		(2*ne + nc*nc) * FFGE_WIDTH * sizeof(int64_t), -1);
+	const size_t out_len = ranks ?
+		h.count * sizeof(uint32_t) : (h.count + 7) / 8;
+	unsigned char *res = calloc(out_len, 1);
+	if (!ar || !res) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	int64_t *w = ffge_arena_alloc_i8(ar, nr, nc);
+	int64_t *s = ffge_arena_alloc_i8(ar, nr, nc);
+	int64_t *k = ffge_arena_alloc_i8(ar, nc, nc);
+
+	size_t ahead = 0, behind = 0;	/* offsets in the file */
+	for (size_t g = 0; g < ng; g++) {
+		const size_t off = sizeof h + g * gs;
+
+		/* keep one window read ahead */
+		if (off + WINDOW > ahead) {
+			readahead(fd, ahead, WINDOW);
+			ahead += WINDOW;
+		}
+		/* release the windows already processed */
+		const size_t done = off / WINDOW * WINDOW;
+		if (done > behind) {
+			madvise(map + behind, done - behind, MADV_DONTNEED);
+			behind = done;
+		}
+
+		int64_t *m = ffge_batch_group(&h, p, g, w);
+		if (ranks) {
+			size_t dim[FFGE_WIDTH];
+			if (m != w)
+				memcpy(w, m, ne * FFGE_WIDTH * sizeof *m);
+			ffge_prim_kernel_i8(w, nr, nc, k, dim);
+			for (size_t l = 0; l < FFGE_WIDTH; l++)
+				if (g*FFGE_WIDTH + l < h.count)
+					((uint32_t *)res)[g*FFGE_WIDTH + l] =
+						nc - dim[l];
+		} else {
+			uint8_t fl = ffge_prim_rank_i8(m, nr, nc, s);
+			if (h.count - g*FFGE_WIDTH < FFGE_WIDTH)
+				fl &= (1 << (h.count - g*FFGE_WIDTH)) - 1;
+			res[g] = fl;
+		}
+	}
+
+	if (write_all(out, res, out_len) < 0) {
+		perror(out);
+		return 1;
+	}
+	free(res);
+	ffge_arena_destroy(ar);
+	munmap(map, len);
+	close(fd);
+
+	return 0;
+}
@@ -0,0 +1,46 @@
+/* -------------------------------------------------------------------------- *
+ * ffge-tune.c: Write the plan of ffge_rank_auto for this machine.            *
+ *                                                                            *
+ * Copyright 2024 Marek Miller & ⧉⧉⧉                                          *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#include <stdio.h>
+
+#include "ffge.h"
+
+int main(int argc, char **argv)
+{
+	const char *path = argc > 1 ? argv[1] : FFGE_PLAN_DEFAULT;
+
+	if (argc > 2 || (argc == 2 && argv[1][0] == '-')) {
+		fprintf(stderr, "usage: ffge-tune [plan]\n");
+		return 1;
+	}
+	if (ffge_tune(path) < 0) {
+		perror(path);
+		return 1;
+	}
+
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		perror(path);
+		return 1;
+	}
+	for (int c; (c = fgetc(f)) != EOF; )
+		putchar(c);
+	fclose(f);
+
+	return 0;
+}
@@ -20,75 +20,98 @@
 #include <stdint.h>
 
 #include "ffge.h"
+#include "ffge_stats.h"
 
 /* Find the next row with non-zero element at pivot column pc. Swap rows.
+ *
+ * The matrix m has nr rows and nc columns.
  *
  * Returns:
  * 	 0	- if no need for swap or the next pivot row foud.
  *	-1	- if no pivot row found and the matrix is singular.
  */
-int ffge_pivot_find(int64_t *m, size_t n, size_t pr, size_t pc)
+int ffge_pivot_find(int64_t *m, size_t nr, size_t nc, size_t pr, size_t pc)
 {
 	size_t i = pr;
-	while (i < n && m[i*n + pc] == 0)
+	while (i < nr && m[i*nc + pc] == 0)
 		i++;
 
-	if (i == n)
+	if (i == nr)
 		return -1;
-	if (i > pr)			/* swap rows i and pr */
-		for (size_t j = pc; j < n; j++) {
+	if (i > pr) {			/* swap rows i and pr */
+		FFGE_STATS_ADD(swaps, 1);
+		for (size_t j = pc; j < nc; j++) {
 			int64_t *x, *y, zz;
-			zz = *(x = m + pr*n + j);
-			*x = *(y = m +  i*n + j);
+			zz = *(x = m + pr*nc + j);
+			*x = *(y = m +  i*nc + j);
 			*y = zz;
 		}
+	}
 
 	return 0;
 }
 
-size_t ffge(int64_t *m, size_t n)
+size_t ffge(int64_t *m, size_t nr, size_t nc)
 {
 	int64_t dv = 1;
 	size_t pc, pr = 0;		/* pivot column, row */
-	for (pc = 0; pc < n; pc++) {
-		if (ffge_pivot_find(m, n, pr, pc) < 0)
+	[[maybe_unused]] size_t ps = 0;	/* 1 + step of first missing pivot */
+	for (pc = 0; pc < nc && pr < nr; pc++) {
+		FFGE_STATS_ADD(steps, 1);
+		if (ffge_pivot_find(m, nr, nc, pr, pc) < 0) {
+			if (ps == 0)
+				ps = pr + 1;
 			continue;
+		}
 
-		const int64_t m_rc = m[pr*n + pc];
-		for (size_t i = pr + 1; i < n; i++) {
-			const int64_t m_ic = m[i*n + pc];
-			for (size_t j = pc + 1; j < n; j++)
-				m[i*n + j] =
-				(m[i*n + j] * m_rc - m[pr*n + j] * m_ic) / dv;
+		const int64_t m_rc = m[pr*nc + pc];
+		for (size_t i = pr + 1; i < nr; i++) {
+			const int64_t m_ic = m[i*nc + pc];
+			for (size_t j = pc + 1; j < nc; j++)
+				m[i*nc + j] =
+				(m[i*nc + j] * m_rc - m[pr*nc + j] * m_ic) / dv;
 
-			m[i*n + pc] = 0;
+			m[i*nc + pc] = 0;
 		}
 		dv = m_rc;
 		pr++;
 	}
+	if (pr < nr && pr < nc)
+		FFGE_STATS_SINGULAR(ps - 1, 1);
 
 	return pr;
 }
 
-size_t ffge_prim(int64_t *m, size_t n)
+size_t ffge_prim(int64_t *m, size_t nr, size_t nc)
 {
 	size_t pc, pr = 0;		/* pivot column, row */
-	for (pc = 0; pc < n; pc++) {
-		if (ffge_pivot_find(m, n, pr, pc) < 0)
+	[[maybe_unused]] size_t ps = 0;	/* 1 + step of first missing pivot */
+	FFGE_STATS_TIMER(t);
+	for (pc = 0; pc < nc && pr < nr; pc++) {
+		FFGE_STATS_ADD(steps, 1);
+		const int rt = ffge_pivot_find(m, nr, nc, pr, pc);
+		FFGE_STATS_LAP(tsc_pivot, t);
+		if (rt < 0) {
+			if (ps == 0)
+				ps = pr + 1;
 			continue;
+		}
 
-		const int64_t m_rc = m[pr*n + pc];
-		for (size_t i = pr + 1; i < n; i++) {
-			const int64_t m_ic = m[i*n + pc];
-			for (size_t j = pc + 1; j < n; j++)
-				m[i*n + j] =
-				(m[i*n + j] * m_rc - m[pr*n + j] * m_ic) %
+		const int64_t m_rc = m[pr*nc + pc];
+		for (size_t i = pr + 1; i < nr; i++) {
+			const int64_t m_ic = m[i*nc + pc];
+			for (size_t j = pc + 1; j < nc; j++)
+				m[i*nc + j] =
+				(m[i*nc + j] * m_rc - m[pr*nc + j] * m_ic) %
 					FFGE_PRIM;
 
-			m[i*n + pc] = 0;
+			m[i*nc + pc] = 0;
 		}
+		FFGE_STATS_LAP(tsc_update, t);
 		pr++;
 	}
+	if (pr < nr && pr < nc)
+		FFGE_STATS_SINGULAR(ps - 1, 1);
 
 	return pr;
 }
@@ -25,45 +25,57 @@
 #define FFGE_PRIM (0x7FFFFFFFL)		/* 2^31 - 1, a Mersenne prime */
 #define FFGE_WIDTH (8)			/* Width of the SIMD vector */
 
-/* Perform in-place FFGE of a square matrix m of size n.
+#define FFGE_PRIM16 (32749)		/* 2^15 - 19, a prime */
+#define FFGE_WIDTH16 (32)		/* Width of the SIMD vector, 16-bit */
+
+/* Number of 64-bit words per row of a bit-packed matrix over GF(2) with
+ * nc columns.  Each row is padded to a multiple of 512 bits. */
+#define FFGE_GF2_STRIDE(nc) ((((nc) + 511) / 512) * 8)
+
+/* Perform in-place FFGE of a matrix m of nr rows and nc columns.
  *
  * The martix is represented as a continuous array of rows, i.e.
- * if i, j = 0, 1, 2, ..., n-1, then the matrix element m_ij is stored at:
+ * if i = 0, 1, 2, ..., nr-1 and j = 0, 1, 2, ..., nc-1, then the matrix
+ * element m_ij is stored at:
  *
- *     m[i*n + j]
+ *     m[i*nc + j]
  *
- * The function returns the rank of the matrix m.
+ * The function returns the rank of the matrix m, at most min(nr, nc).
  */
-size_t ffge(int64_t *m, size_t n);
+size_t ffge(int64_t *m, size_t nr, size_t nc);
 
-/* Perform in-place FFGE of a square matrix m of size n over the prime
- * field Z_p for p = FFGE_PRIM.
+/* Perform in-place FFGE of a matrix m of nr rows and nc columns over
+ * the prime field Z_p for p = FFGE_PRIM.
  *
- * Assume n < FFGE_PRIM.
+ * Assume nr, nc < FFGE_PRIM.
  *
  * The martix is represented as a continuous array of rows, i.e.
- * if i, j = 0, 1, 2, ..., n-1, then the matrix element m_ij is stored at:
+ * if i = 0, 1, 2, ..., nr-1 and j = 0, 1, 2, ..., nc-1, then the matrix
+ * element m_ij is stored at:
  *
- *     m[i*n + j]
+ *     m[i*nc + j]
  *
- * The function returns the rank of the matrix m (modulo FFGE_PRIM).
+ * The function returns the rank of the matrix m (modulo FFGE_PRIM),
+ * at most min(nr, nc).
  */
-size_t ffge_prim(int64_t *m, size_t n);
+size_t ffge_prim(int64_t *m, size_t nr, size_t nc);
 
-/* Perform in-place FFGE of FFGE_WIDTH packed square matrices of size n,
- * over the prime field Z_p for p = FFGE_PRIM = 2^31 - 1.
+/* Perform in-place FFGE of FFGE_WIDTH packed matrices of nr rows and
+ * nc columns, over the prime field Z_p for p = FFGE_PRIM = 2^31 - 1.
  *
- * Assume n < FFGE_PRIM.
+ * Assume nr, nc < FFGE_PRIM.
  *
  * The matrices are represented as a continuous array of packed rows, i.e. if
- * i, j = 0, 1, 2, ... n-1, and k = 0, 1, ..., FFGE_WIDTH-1, then
- * the i,j-th element of the k-th matrix, (m_k)_{i,j} is stored at
+ * i = 0, 1, 2, ... nr-1, j = 0, 1, 2, ..., nc-1, and k = 0, 1, ...,
+ * FFGE_WIDTH-1, then the i,j-th element of the k-th matrix, (m_k)_{i,j}
+ * is stored at
  *
- *     m[(i*n + j)*FFGE_WIDTH + k]
+ *     m[(i*nc + j)*FFGE_WIDTH + k]
  *
  * This function is fast, but the result is correct only for those packed
  * matrices that are full-rank.  The matrices that are singular (and only
- * those) are destroyed as a result of this function.
+ * those) are destroyed as a result of this function.  If nc > nr, the
+ * columns of a matrix may be permuted as well.
  *
  * The matrix m must be aligned to the 64 byte boundary.  For example, for
  * a square matrix of size SIZE, one can alocate static storage explicitly by:
@@ -71,9 +83,9 @@ size_t ffge_prim(int64_t *m, size_t n);
  *     alignas(64) int64_t m[SIZE * SIZE * FFGE_WIDTH];
  *
  * The function returns a set of flags indicating which matrices have full rank,
- * i.e. for
+ * i.e. rank equal to min(nr, nc).  For
  *
- *     uint8_t fl = ffge_prim_i8(m, n);
+ *     uint8_t fl = ffge_prim_i8(m, nr, nc);
  *
  * the number
  *
@@ -81,6 +93,672 @@ size_t ffge_prim(int64_t *m, size_t n);
  *
  * is equal to 1 if k-th matrix has full rank, k = 0, 1, ..., FFGE_WIDTH-1.
  */
-uint8_t ffge_prim_i8(int64_t *m, size_t n);
+uint8_t ffge_prim_i8(int64_t *m, size_t nr, size_t nc);
+
+/* Same as ffge_prim_i8(), but return as soon as any of the matrices given by
+ * the mask stop is found singular, i.e. when (fl & stop) != stop.
+ *
+ * After an early return, the flags of the matrices found singular so far
+ * are cleared, but the other flags are set regardless of the rank, and all
+ * the matrices are destroyed.  For stop = 0xff, the result is 0xff if and
+ * only if all the matrices have full rank.  For stop = 0, the function is
+ * equivalent to ffge_prim_i8().  Both return once all the matrices are
+ * found singular.
+ */
+uint8_t ffge_prim_i8_stop(int64_t *m, size_t nr, size_t nc, uint8_t stop);
+
+/* Decide which of FFGE_WIDTH packed matrices of nr rows and nc columns have
+ * full rank, over Z_p for p = FFGE_PRIM.
+ *
+ * The matrices are packed as in ffge_prim_i8(), and the function returns the
+ * same flags.  Unlike ffge_prim_i8(), the matrices m are not modified.  The
+ * elimination runs in the work array w instead, which stores only the active
+ * submatrix, contiguously, as it shrinks.  The eliminated rows and columns
+ * are never written.
+ *
+ * The arrays m and w must be aligned to the 64 byte boundary, and w must
+ * hold nr*nc*FFGE_WIDTH elements.
+ */
+uint8_t ffge_prim_rank_i8(const int64_t *m, size_t nr, size_t nc, int64_t *w);
+
+/* Perform in-place FFGE of FFGE_WIDTH16 packed matrices of nr rows and
+ * nc columns, over the prime field Z_p for p = FFGE_PRIM16 = 2^15 - 19.
+ *
+ * This is a fast, but less precise version of ffge_prim_i8() that processes
+ * four times as many matrices at once.  It can be used to screen a large set
+ * of matrices quickly, e.g. a matrix that is full-rank modulo FFGE_PRIM16 has
+ * a non-zero determinant (or maximal minor) over the integers.
+ *
+ * The elements of the matrices must be in the range 0, 1, ..., FFGE_PRIM16-1
+ * and are represented as a continuous array of packed rows, i.e. if
+ * i = 0, 1, 2, ... nr-1, j = 0, 1, 2, ..., nc-1, and k = 0, 1, ...,
+ * FFGE_WIDTH16-1, then the i,j-th element of the k-th matrix is stored at
+ *
+ *     m[(i*nc + j)*FFGE_WIDTH16 + k]
+ *
+ * The rows of the resulting echelon forms are multiplied by non-zero
+ * constants, and the matrices that are singular are destroyed, just like
+ * in ffge_prim_i8().  The matrix m must be aligned to the 64 byte boundary.
+ *
+ * The function returns a set of flags indicating which matrices have full
+ * rank, i.e. rank equal to min(nr, nc).  The k-th bit of the result is set
+ * if the k-th matrix has full rank, k = 0, 1, ..., FFGE_WIDTH16-1.
+ */
+uint32_t ffge_prim16_i32(uint16_t *m, size_t nr, size_t nc);
+
+/* Number of int64_t elements of the work array of ffge_screen_i32(). */
+#define FFGE_SCREEN_WORK(nr, nc) ((nr) * (nc) * 2 * FFGE_WIDTH)
+
+/* Counters of ffge_screen_i32(), accumulated over calls.  Set all fields to
+ * zero before the first call.
+ */
+struct ffge_screen_stats {
+	uint64_t lanes;		/* matrices screened */
+	uint64_t full;		/* full-rank modulo FFGE_PRIM16, i.e. certain */
+	uint64_t checked;	/* passed on to ffge_prim_i8() */
+	uint64_t singular;	/* found singular by ffge_prim_i8() */
+	uint64_t calls_i8;	/* calls to ffge_prim_i8() */
+};
+
+/* Decide which of FFGE_WIDTH16 matrices of nr rows and nc columns have full
+ * rank, i.e. rank equal to min(nr, nc), screening them first modulo
+ * a small prime.
+ *
+ * The matrices are stored as FFGE_WIDTH16/FFGE_WIDTH consecutive batches
+ * packed as in ffge_prim_i8(), i.e. the i,j-th element of the k-th matrix
+ * is stored at:
+ *
+ *     m[((k/FFGE_WIDTH)*nr*nc + i*nc + j)*FFGE_WIDTH + k%FFGE_WIDTH]
+ *
+ * The elements are treated as integers.  First, all matrices are reduced
+ * modulo FFGE_PRIM16 and eliminated with ffge_prim16_i32().  A matrix that
+ * is full-rank modulo FFGE_PRIM16 has a non-zero maximal minor, hence it has
+ * full rank over the integers, and this is certain.  The remaining matrices
+ * are likely singular.  If exact is true, they are repacked densely and
+ * checked with ffge_prim_i8(), and their flags are as in ffge_prim_i8().
+ * Otherwise, they are reported as singular, which is wrong for a full-rank
+ * matrix with probability roughly 1/FFGE_PRIM16.
+ *
+ * Note that the result differs from ffge_prim_i8() for matrices that are
+ * full-rank over the integers, but singular modulo FFGE_PRIM: these are
+ * reported as full-rank, if found so by the screen.
+ *
+ * The matrix m is left intact.  The array w, aligned to the 64 byte boundary,
+ * must hold FFGE_SCREEN_WORK(nr, nc) elements.  If st is not nullptr,
+ * the counters of each stage are added to it.
+ *
+ * The function returns a set of full-rank flags: the k-th bit of the result
+ * is set if the k-th matrix has full rank, k = 0, 1, ..., FFGE_WIDTH16-1.
+ */
+uint32_t ffge_screen_i32(const int64_t *m, size_t nr, size_t nc, bool exact,
+		int64_t *w, struct ffge_screen_stats *st);
+
+/* Number of elements of a symmetric matrix of size n, stored as its upper
+ * triangle, see ffge_sym_prim().
+ */
+#define FFGE_SYM_SIZE(n) ((n) * ((n) + 1) / 2)
+
+/* Perform in-place FFGE of a symmetric matrix m of size n over the prime
+ * field Z_p for p = FFGE_PRIM.
+ *
+ * Only the upper triangle of the matrix is stored, packed row by row, i.e.
+ * if 0 <= i <= j < n, then the element m_ij = m_ji is stored at:
+ *
+ *     m[i*(2*n - i + 1)/2 + j - i]
+ *
+ * and the array m holds FFGE_SYM_SIZE(n) elements.  The Schur complement of
+ * each pivot is symmetric, and only its upper triangle is updated: this takes
+ * about half the memory and arithmetic of ffge_prim().
+ *
+ * The pivots are taken from the diagonal, with rows and columns swapped
+ * symmetrically.  If the diagonal of the remaining submatrix is zero, a row
+ * and column are added to another one to make a non-zero diagonal element.
+ * On return, the pivots of the fraction-free LDL^T factorization of the
+ * permuted matrix are on the diagonal, and the rows of the upper triangle
+ * hold the rows of its echelon form.
+ *
+ * The function returns the rank of the matrix m (modulo FFGE_PRIM).
+ */
+size_t ffge_sym_prim(int64_t *m, size_t n);
+
+/* Perform in-place FFGE of FFGE_WIDTH packed symmetric matrices of size n,
+ * over Z_p for p = FFGE_PRIM, like ffge_sym_prim().
+ *
+ * The i,j-th element of the k-th matrix, for i <= j, is stored at:
+ *
+ *     m[(i*(2*n - i + 1)/2 + j - i)*FFGE_WIDTH + k]
+ *
+ * The function returns a set of full-rank flags, just like ffge_prim_i8(),
+ * and the matrices that are singular are destroyed.
+ */
+uint8_t ffge_sym_prim_i8(int64_t *m, size_t n);
+
+/* Compute in-place PLU factorization of a square matrix m of size n over
+ * the prime field Z_p for p = FFGE_PRIM.
+ *
+ * Assume n < FFGE_PRIM.
+ *
+ * The matrix is represented as in ffge_prim() with nr = nc = n.  Upon
+ * return, m holds the upper triangular matrix U on and above the diagonal,
+ * and the unit lower triangular matrix L (without its diagonal) below it,
+ * such that
+ *
+ *     P m = L U,
+ *
+ * where P is the permutation matrix given by the array p of size n:
+ * at the k-th elimination step, the row k was swapped with the row p[k].
+ *
+ * The function returns the rank of the matrix m (modulo FFGE_PRIM).
+ * The factorization can be used to solve linear systems only if the rank
+ * is equal to n.
+ */
+size_t ffge_prim_lu(int64_t *m, size_t *p, size_t n);
+
+/* Solve the linear system m x = b over Z_p, given the factorization m, p
+ * of size n computed by ffge_prim_lu().
+ *
+ * The vector b of size n is overwritten with the solution x.  The cost of
+ * this function is O(n^2), and the factorization is left intact.
+ *
+ * Returns:
+ *	 0	- if the solution is found.
+ *	-1	- if the matrix is singular.  The vector b is left unchanged.
+ */
+int ffge_prim_lu_solve(const int64_t *m, const size_t *p, size_t n,
+			int64_t *b);
+
+/* Compute in-place PLU factorization of FFGE_WIDTH packed square matrices
+ * of size n over the prime field Z_p for p = FFGE_PRIM.
+ *
+ * The matrices are packed as in ffge_prim_i8() with nr = nc = n, and each
+ * is factorized as in ffge_prim_lu().  The permutations are packed as well:
+ * the k-th matrix swapped its rows i and p[i*FFGE_WIDTH + k].  The array p
+ * must hold n*FFGE_WIDTH elements.
+ *
+ * The function returns a set of full-rank flags, just like ffge_prim_i8().
+ */
+uint8_t ffge_prim_lu_i8(int64_t *m, size_t *p, size_t n);
+
+/* Solve FFGE_WIDTH linear systems at once, given the packed factorizations
+ * m, p computed by ffge_prim_lu_i8().
+ *
+ * The i-th element of the k-th right-hand side is stored at:
+ *
+ *     b[i*FFGE_WIDTH + k]
+ *
+ * and is overwritten with the solution.  The solutions are correct only for
+ * those matrices whose full-rank flag is set.
+ */
+void ffge_prim_lu_solve_i8(const int64_t *m, const size_t *p, size_t n,
+			int64_t *b);
+
+/* Compute a basis of the kernel (nullspace) of a matrix m of nr rows and
+ * nc columns over the prime field Z_p for p = FFGE_PRIM.
+ *
+ * Assume nr, nc < FFGE_PRIM.
+ *
+ * The matrix is represented as in ffge_prim().  The function brings m to
+ * its echelon form by calling ffge_prim(), and then further to the reduced
+ * row echelon form, with all pivots equal to 1.
+ *
+ * The basis vectors v_d, d = 0, 1, ..., nc - rank - 1, each of size nc, are
+ * stored in k as a continuous array, i.e. the j-th element of v_d is:
+ *
+ *     k[d*nc + j]
+ *
+ * The array k must have room for (nc - rank)*nc elements, where rank is
+ * the rank of m.  The room for nc*nc elements is always enough.
+ *
+ * The function returns the dimension of the kernel, i.e. nc - rank.
+ */
+size_t ffge_prim_kernel(int64_t *m, size_t nr, size_t nc, int64_t *k);
+
+/* Compute bases of the kernels of FFGE_WIDTH packed matrices of nr rows and
+ * nc columns, over the prime field Z_p for p = FFGE_PRIM.
+ *
+ * The matrices are packed as in ffge_prim_i8() and are brought to their
+ * reduced row echelon forms.  Unlike ffge_prim_i8(), the function computes
+ * the correct result for singular matrices too.
+ *
+ * The basis vectors are packed as well: the j-th element of the d-th basis
+ * vector of the i-th matrix is stored at:
+ *
+ *     k[(d*nc + j)*FFGE_WIDTH + i]
+ *
+ * and the dimension of the kernel of the i-th matrix at dim[i].  The array
+ * k must have room for nc*nc*FFGE_WIDTH elements.  The elements of k past
+ * the last basis vector of each matrix are set to zero.  The array dim must
+ * hold FFGE_WIDTH elements.
+ *
+ * The function returns a set of full-rank flags, just like ffge_prim_i8().
+ */
+uint8_t ffge_prim_kernel_i8(int64_t *m, size_t nr, size_t nc, int64_t *k,
+			size_t *dim);
+
+/* Perform in-place Gaussian elimination of a matrix m of nr rows and nc
+ * columns over the field GF(2).
+ *
+ * The matrix is represented as a continuous array of rows of bits.  Each
+ * row takes FFGE_GF2_STRIDE(nc) 64-bit words, i.e. if i = 0, 1, ..., nr-1
+ * and j = 0, 1, ..., nc-1, then the matrix element m_ij is the bit:
+ *
+ *     (m[i*FFGE_GF2_STRIDE(nc) + j/64] >> (j%64)) & 1
+ *
+ * The bits past the last column are ignored, but they may be modified.
+ *
+ * The matrix m must be aligned to the 64 byte boundary.  For large matrices,
+ * the function uses the Method of Four Russians and allocates temporary
+ * lookup tables on the heap.
+ *
+ * The function brings m to a row echelon form and returns its rank.
+ */
+size_t ffge_gf2(uint64_t *m, size_t nr, size_t nc);
+
+/* Perform in-place Gaussian elimination of FFGE_WIDTH packed matrices of nr
+ * rows and nc <= 64 columns over the field GF(2).
+ *
+ * The matrices are represented as a continuous array of packed rows of bits,
+ * i.e. if i = 0, 1, ..., nr-1, j = 0, 1, ..., nc-1 and k = 0, 1, ...,
+ * FFGE_WIDTH-1, then the i,j-th element of the k-th matrix is the bit:
+ *
+ *     (m[i*FFGE_WIDTH + k] >> j) & 1
+ *
+ * The matrix m must be aligned to the 64 byte boundary.
+ *
+ * The function returns a set of flags indicating which matrices have full
+ * rank, i.e. rank equal to min(nr, nc), just like ffge_prim_i8().  Unlike
+ * ffge_prim_i8(), the rows of the matrices are not permuted.
+ */
+uint8_t ffge_gf2_i8(uint64_t *m, size_t nr, size_t nc);
+
+/* Binary container of a batch of matrices (see ffge-rank.c): a header of
+ * 64 bytes, struct ffge_batch, followed by the payload.
+ *
+ * The elements are signed integers of width bytes, 4 or 8, little-endian.
+ * If layout is FFGE_BATCH_ROWS, the payload holds count matrices of nr rows
+ * and nc columns, one after another, each as in ffge_prim().  If layout is
+ * FFGE_BATCH_PACKED, the width must be 8, and the payload holds count/8
+ * groups of FFGE_WIDTH matrices, rounded up, each packed as in ffge_prim_i8().
+ * The lanes past the last matrix of the last group are ignored.
+ */
+#define FFGE_BATCH_MAGIC "FFGEBAT1"
+#define FFGE_BATCH_ROWS (0)
+#define FFGE_BATCH_PACKED (1)
+
+struct ffge_batch {
+	char magic[8];		/* FFGE_BATCH_MAGIC, without the final '\0' */
+	uint64_t nr;
+	uint64_t nc;
+	uint64_t count;
+	uint32_t width;
+	uint32_t layout;
+	uint64_t reserved[3];	/* zero */
+};
+
+/* Return the size of the payload of the batch h in bytes, or 0 if the header
+ * is invalid.
+ */
+size_t ffge_batch_size(const struct ffge_batch *h);
+
+/* Return the g-th group of FFGE_WIDTH matrices of the batch h with payload p,
+ * packed as in ffge_prim_i8(), where g < (h->count + 7) / 8.
+ *
+ * If the layout of the batch is FFGE_BATCH_PACKED, the function returns
+ * a pointer to the payload, without copying, and p must be aligned to the 64
+ * byte boundary.  Otherwise, the matrices are packed to w and the function
+ * returns w.  The array w must be aligned to the 64 byte boundary and hold
+ * h->nr*h->nc*FFGE_WIDTH elements.  The lanes past the last matrix are set
+ * to the identity matrix, which the kernels eliminate without a search.
+ */
+int64_t *ffge_batch_group(const struct ffge_batch *h, void *p, size_t g,
+		int64_t *w);
+
+/* Arena of memory for packed matrices, see ffge_arena_create(). */
+struct ffge_arena;
+
+/* Create an arena of at least size bytes.
+ *
+ * The memory is backed by 2 MiB huge pages, if available (MAP_HUGETLB).
+ * Otherwise, transparent huge pages are requested with madvise(2), and
+ * the arena falls back to regular pages if they are not supported either.
+ *
+ * If node >= 0, the memory is placed preferably on the given NUMA node.
+ * The pages are touched by the calling thread before the function returns,
+ * hence for node < 0, the memory is local to the calling thread.  Create one
+ * arena per worker thread, from the thread itself.  The functions operating
+ * on the same arena are not thread-safe.
+ *
+ * Returns a pointer to the arena, or nullptr if the memory cannot be mapped.
+ */
+struct ffge_arena *ffge_arena_create(size_t size, int node);
+
+/* Allocate size bytes from the arena a.  The memory is aligned to the 64 byte
+ * boundary and can hold packed matrices, e.g. for ffge_prim_i8().
+ *
+ * The memory is never freed individually, only all at once by
+ * ffge_arena_reset() or ffge_arena_destroy().
+ *
+ * Returns a pointer to the memory, or nullptr if the arena is full.
+ */
+void *ffge_arena_alloc(struct ffge_arena *a, size_t size);
+
+/* Allocate room for FFGE_WIDTH packed matrices of nr rows and nc columns,
+ * i.e. a single argument to ffge_prim_i8(), from the arena a.
+ */
+int64_t *ffge_arena_alloc_i8(struct ffge_arena *a, size_t nr, size_t nc);
+
+/* Make all the memory of the arena a available again, without unmapping it.
+ * The pointers allocated so far become invalid.
+ */
+void ffge_arena_reset(struct ffge_arena *a);
+
+/* Unmap the memory of the arena a, and free the arena.  The pointer a can
+ * be nullptr.
+ */
+void ffge_arena_destroy(struct ffge_arena *a);
+
+/* Queue of single matrices, collected into groups for ffge_prim_i8(), see
+ * ffge_queue_create().
+ */
+struct ffge_queue;
+
+/* Callback of the queue, called once for each submitted matrix with its tag,
+ * the data passed to ffge_queue_create(), and the result: true if the matrix
+ * has full rank.
+ */
+typedef void ffge_queue_fn(void *tag, bool full_rank, void *data);
+
+/* Counters of the queue, see ffge_queue_get_stats(). */
+struct ffge_queue_stats {
+	uint64_t submitted;	/* matrices accepted by ffge_queue_submit() */
+	uint64_t rejected;	/* matrices rejected, the queue being full */
+	uint64_t groups;	/* groups passed to ffge_prim_i8() */
+	uint64_t partial;	/* groups with fewer than FFGE_WIDTH matrices */
+	uint64_t lanes;		/* matrices in all groups */
+};
+
+/* Create a queue of matrices of nr rows and nc columns, with room for at
+ * least cap matrices (rounded up to a power of two).
+ *
+ * Any number of threads can submit matrices to the queue and dispatch them,
+ * concurrently.  The queue is lock-free.  Once FFGE_WIDTH matrices are
+ * available, ffge_queue_poll() packs them and calls ffge_prim_i8().  A group
+ * of fewer matrices is dispatched only if the oldest of them has waited for
+ * at least deadline nanoseconds.  A longer deadline means fewer partial
+ * groups, i.e. better throughput, at the cost of latency.
+ *
+ * For each matrix, the function fn is called with the argument data by the
+ * thread that dispatched it.
+ *
+ * Returns a pointer to the queue, or nullptr if the memory cannot be
+ * allocated.
+ */
+struct ffge_queue *ffge_queue_create(size_t nr, size_t nc, size_t cap,
+		uint64_t deadline, ffge_queue_fn *fn, void *data);
+
+/* Copy the matrix m, stored row by row, to the queue q.  The elements must be
+ * as for ffge_prim_i8().  The tag is passed to the callback of the queue.
+ *
+ * Returns true, or false if the queue is full.
+ */
+bool ffge_queue_submit(struct ffge_queue *q, const int64_t *m, void *tag);
+
+/* Dispatch at most one group of matrices from the queue q: FFGE_WIDTH of
+ * them, or fewer, if the deadline of the oldest one has passed or if flush
+ * is true.  The unused lanes are padded with the identity matrix, and their
+ * flags are ignored.
+ *
+ * The array w holds the packed group.  It must be aligned to the 64 byte
+ * boundary and hold nr*nc*FFGE_WIDTH elements, e.g. ffge_arena_alloc_i8().
+ *
+ * Returns the number of matrices dispatched, 0 if there were none ready.
+ */
+size_t ffge_queue_poll(struct ffge_queue *q, bool flush, int64_t *w);
+
+/* Copy the counters of the queue q to st. */
+void ffge_queue_get_stats(const struct ffge_queue *q,
+		struct ffge_queue_stats *st);
+
+/* Free the queue q.  The matrices still in the queue are discarded, without
+ * calling the callback.  The pointer q can be nullptr.
+ */
+void ffge_queue_destroy(struct ffge_queue *q);
+
+/* Stages of ffge_pipe_run(), in order. */
+enum {
+	FFGE_PIPE_GENERATE,
+	FFGE_PIPE_PACK,
+	FFGE_PIPE_ELIMINATE,
+	FFGE_PIPE_COLLECT,
+	FFGE_PIPE_STAGES
+};
+
+/* Producer of ffge_pipe_run(): store the next matrix in m, row by row, with
+ * the elements as for ffge_prim_i8(), and its tag in *tag.  Returns false,
+ * without storing anything, once there are no more matrices.
+ */
+typedef bool ffge_pipe_gen_fn(int64_t *m, void **tag, void *data);
+
+/* Consumer of ffge_pipe_run(): called once for each matrix, in the order of
+ * the producer, with its tag and the result: true if it has full rank.
+ */
+typedef void ffge_pipe_collect_fn(void *tag, bool full_rank, void *data);
+
+/* Counters of a stage of ffge_pipe_run(). */
+struct ffge_pipe_stage_stats {
+	uint64_t groups;	/* groups processed */
+	uint64_t busy_ns;	/* time spent processing them */
+	uint64_t wait_ns;	/* time spent waiting for a group */
+	uint64_t depth;		/* sum of groups waiting in the input ring */
+};
+
+/* Counters of ffge_pipe_run().  The occupancy of stage s is the fraction
+ * stage[s].busy_ns / ns, and its input ring holds on average
+ * stage[s].depth / stage[s].groups groups.  For FFGE_PIPE_GENERATE, the
+ * input is the ring of free groups, and the time waiting for it is the
+ * backpressure of the later stages.
+ */
+struct ffge_pipe_stats {
+	uint64_t matrices;
+	uint64_t ns;		/* wall time of the pipeline */
+	struct ffge_pipe_stage_stats stage[FFGE_PIPE_STAGES];
+};
+
+/* Compute the ranks of a stream of matrices of nr rows and nc columns, over
+ * Z_p for p = FFGE_PRIM, with the steps run concurrently by a pipeline of
+ * four threads: gen() fills groups of FFGE_WIDTH matrices, which are packed,
+ * passed to ffge_prim_i8(), and handed to collect().  The last group can be
+ * partial and is padded with the identity matrix.
+ *
+ * The stages pass groups through single-producer single-consumer rings.  A
+ * fixed number of groups (at least 1, better 2 * FFGE_PIPE_STAGES) are
+ * allocated up front and recycled: once all of them are in flight, the
+ * first stage waits, so the memory is bounded.  An empty ring is polled,
+ * yielding the CPU after a while.
+ *
+ * If cpu is not nullptr, the thread of stage s is pinned to the CPU cpu[s],
+ * unless it is negative.  E.g. packing and elimination can share a core as
+ * SMT siblings.  The functions gen() and collect() are called with the
+ * argument data from different threads, concurrently with each other.
+ *
+ * If st is not nullptr, the counters are written to it.
+ *
+ * Returns 0 once all the matrices are collected, or -1 if the memory cannot
+ * be allocated or a thread cannot be created or pinned, in which case no
+ * matrix is processed.
+ */
+int ffge_pipe_run(size_t nr, size_t nc, size_t groups, const int *cpu,
+		ffge_pipe_gen_fn *gen, ffge_pipe_collect_fn *collect,
+		void *data, struct ffge_pipe_stats *st);
+
+/* Counters of ffge_sched_i8(). */
+struct ffge_sched_stats {
+	uint64_t groups;	/* calls to ffge_prim_i8() */
+	uint64_t partial;	/* groups with fewer than FFGE_WIDTH matrices */
+	uint64_t padded;	/* matrices embedded in a larger size */
+	uint64_t cost;		/* estimated cost of all groups, see below */
+};
+
+/* Decide which of count square matrices of different sizes have full rank,
+ * over Z_p for p = FFGE_PRIM.
+ *
+ * The l-th matrix has size n[l] > 0 and is stored row by row at m[l], with
+ * the elements as for ffge_prim_i8().  The matrices are not modified.
+ *
+ * The matrices are sorted by size and split into groups for ffge_prim_i8().
+ * A matrix of size n can be placed in a group of size n + d, for d <= pad,
+ * as the block diagonal matrix diag(m, I) with the identity block I of size
+ * d, which has full rank if and only if m does.  Among such groupings, the
+ * function chooses one with the least estimated cost, where the cost of
+ * a group of size n is n*n*(n + 16), regardless of the number of matrices.
+ * For pad = 0, only matrices of the same size are grouped together.
+ *
+ * On return, full[l] is true if the l-th matrix has full rank.  If st is
+ * not nullptr, the counters are stored there.
+ *
+ * Returns 0, or -1 if the memory cannot be allocated.
+ */
+int ffge_sched_i8(const int64_t *const *m, const size_t *n, size_t count,
+		size_t pad, bool *full, struct ffge_sched_stats *st);
+
+/* Default path of the plan of ffge_rank_auto(), unless the environment
+ * variable FFGE_PLAN is set.
+ */
+#define FFGE_PLAN_DEFAULT "ffge.plan"
+
+/* Compute the ranks of count matrices of nr rows and nc columns, over Z_p
+ * for p = FFGE_PRIM, with the kernel that is the fastest on this machine.
+ *
+ * The matrices are stored one after another, row by row, with elements as
+ * for ffge_prim(), and are not modified.  On return, rank[l] is the rank of
+ * the l-th matrix.
+ *
+ * The candidate kernels are ffge_prim(), ffge_prim_i8() followed by
+ * ffge_prim() for the singular matrices only, and ffge_prim_kernel_i8().
+ * The choice depends on max(nr, nc) and count, and is read from the plan
+ * written by ffge_tune().  The plan is loaded at the first call, from the
+ * file given by the environment variable FFGE_PLAN or FFGE_PLAN_DEFAULT.
+ * Without a plan, the packed kernels are chosen for count > 1.
+ *
+ * Returns 0, or -1 if the memory cannot be allocated.
+ */
+int ffge_rank_auto(const int64_t *m, size_t nr, size_t nc, size_t count,
+		size_t *rank);
+
+/* Return the name of the kernel chosen by ffge_rank_auto() for count
+ * matrices of nr rows and nc columns.
+ */
+const char *ffge_rank_auto_kernel(size_t nr, size_t nc, size_t count);
+
+/* Load the plan of ffge_rank_auto() from the file at path, replacing the
+ * current one.  The entries missing from the file are set to the defaults.
+ * Not thread-safe: call it before ffge_rank_auto() is used by other threads.
+ *
+ * Returns 0, or -1 if the file cannot be read or is not a valid plan.
+ */
+int ffge_plan_load(const char *path);
+
+/* Time the kernels of ffge_rank_auto() on this machine, for square matrices
+ * of sizes 2 to 64 and batches of 1 to 64 matrices, and use the fastest ones
+ * from now on.  If path is not nullptr, write the plan to the file at path.
+ * This takes a few seconds.  Not thread-safe, like ffge_plan_load().
+ *
+ * Returns 0, or -1 if the memory cannot be allocated or the file written.
+ */
+int ffge_tune(const char *path);
+
+/* Density at which ffge_sparse_rank() should switch to a dense kernel. */
+#define FFGE_SPARSE_DENSE (0.1)
+
+/* Counters of ffge_sparse_rank(). */
+struct ffge_sparse_stats {
+	uint64_t pivots;	/* pivots eliminated in the sparse phase */
+	uint64_t fill;		/* non-zero elements created by elimination */
+	uint64_t nnz_peak;	/* non-zero elements stored, at most */
+	uint64_t dense_nr;	/* size of the dense remainder, or 0 */
+	uint64_t dense_nc;
+};
+
+/* Compute the rank of a sparse matrix of nr rows and nc columns, over Z_p
+ * for p = FFGE_PRIM.
+ *
+ * The matrix is in the compressed sparse row format: the elements of the
+ * i-th row are v[rp[i]], ..., v[rp[i+1] - 1], in the columns ci[rp[i]], ...,
+ * ci[rp[i+1] - 1], in increasing order.  The elements are as for
+ * ffge_prim(); zeros are allowed and skipped.  The arrays are not modified.
+ *
+ * The pivots are chosen to keep the fill-in low, by the Markowitz criterion:
+ * among the column with the fewest non-zero elements and the row with the
+ * fewest ones, take the element a_ij with the least (r_i - 1)(c_j - 1),
+ * where r_i and c_j are the counts of non-zero elements in its row and its
+ * column.  Once the remaining submatrix has at least the fraction dense of
+ * non-zero elements (e.g. FFGE_SPARSE_DENSE), it is copied to a dense
+ * matrix and its rank is computed by ffge_rank_auto().  With dense > 1, the
+ * elimination is sparse until the end.  If st is not nullptr, the counters
+ * are written to it.
+ *
+ * Returns the rank, or SIZE_MAX if the memory cannot be allocated.
+ */
+size_t ffge_sparse_rank(const size_t *rp, const size_t *ci, const int64_t *v,
+		size_t nr, size_t nc, double dense,
+		struct ffge_sparse_stats *st);
+
+/* Counters of ffge_wiedemann_rank(). */
+struct ffge_wiedemann_stats {
+	uint64_t steps;		/* terms of the sequence u^T B^k x */
+	uint64_t degree;	/* of the minimal polynomial of B */
+};
+
+/* Compute the rank of a sparse matrix A of nr rows and nc columns, over Z_p
+ * for p = FFGE_PRIM, by the Wiedemann algorithm.  The matrix is given as
+ * for ffge_sparse_rank() and is only multiplied by vectors, so there is no
+ * fill-in: the memory is linear in the size of the input.
+ *
+ * With random diagonal matrices D1 and D2 determined by seed, the rank of A
+ * is read off the minimal polynomial of B = D1 A^T D2 A D1, found by the
+ * Berlekamp-Massey algorithm from the sequence u^T B^k x, k = 0, 1, ...,
+ * with random vectors u and x.  FFGE_WIDTH such sequences are computed at
+ * once, so that each element of A is loaded once for FFGE_WIDTH products.
+ * The products are split by rows among the given number of threads, at most
+ * FFGE_WIDTH.  The cost is about 4 * min(nr, nc) products by A.
+ *
+ * The result is correct with high probability: it can only be too small,
+ * for an unlucky choice of seed.  If st is not nullptr, the counters are
+ * written to it.
+ *
+ * Returns the rank, or SIZE_MAX if the memory cannot be allocated.
+ */
+size_t ffge_wiedemann_rank(const size_t *rp, const size_t *ci,
+		const int64_t *v, size_t nr, size_t nc, size_t threads,
+		uint64_t seed, struct ffge_wiedemann_stats *st);
+
+#ifdef FFGE_STATS
+/* Number of pivot steps in the histogram of singular matrices. */
+#define FFGE_STATS_STEPS (64)
+
+/* Statistics collected by the instrumentation build of the library, i.e.
+ * compiled with -DFFGE_STATS (see: make profile).  Each thread has its own
+ * copy.  The counters are updated by ffge(), ffge_prim() and ffge_prim_i8(),
+ * and by the functions that call them.
+ */
+struct ffge_stats {
+	uint64_t steps;		/* pivot steps, one per column for all lanes */
+	uint64_t swaps;		/* row and column swaps */
+	uint64_t singular;	/* matrices (or lanes) found singular */
+	/* matrices found singular at pivot step s < FFGE_STATS_STEPS - 1,
+	 * or at any later step for s = FFGE_STATS_STEPS - 1 */
+	uint64_t singular_at[FFGE_STATS_STEPS];
+	/* TSC ticks spent on pivot search and on row updates, if compiled
+	 * with -DFFGE_STATS_TSC as well; 0 otherwise */
+	uint64_t tsc_pivot;
+	uint64_t tsc_update;
+};
+
+/* Copy the statistics of the calling thread to st. */
+void ffge_stats_get(struct ffge_stats *st);
+
+/* Set the statistics of the calling thread to zero. */
+void ffge_stats_reset(void);
+#endif /* FFGE_STATS */
 
 #endif /* FFGE_H */
@@ -0,0 +1,139 @@
+/* -------------------------------------------------------------------------- *
+ * ffge_arena.c: Huge-page arena allocator for packed matrices.               *
+ *                                                                            *
+ * Copyright 2024 Marek Miller & ⧉⧉⧉                                          *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#define _GNU_SOURCE
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "ffge.h"
+
+#define FFGE_ARENA_PAGE (UINT64_C(2) << 20)	/* 2 MiB */
+#define FFGE_ARENA_ALIGN (64)
+
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)	/* log2 of the page size */
+#endif
+
+struct ffge_arena {
+	unsigned char *base;	/* start of the memory */
+	size_t size;		/* size of the memory */
+	size_t used;		/* bytes handed out */
+	unsigned char *map;	/* start of the mapping, to be unmapped */
+	size_t map_size;
+};
+
+/* Map size bytes, a multiple of FFGE_ARENA_PAGE, aligned to FFGE_ARENA_PAGE.
+ * Try explicit huge pages of 2 MiB first, whatever the default huge page
+ * size, then transparent huge pages.
+ */
+static int ffge_arena_map(struct ffge_arena *a, size_t size)
+{
+	void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB,
+		-1, 0);
+	if (p != MAP_FAILED) {
+		a->base = a->map = p;
+		a->size = a->map_size = size;
+		return 0;
+	}
+
+	/* over-map to align the memory to the huge page boundary */
+	const size_t map_size = size + FFGE_ARENA_PAGE;
+	p = mmap(nullptr, map_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED)
+		return -1;
+
+	a->map = p;
+	a->map_size = map_size;
+	a->base = (unsigned char *)(((uintptr_t)p + FFGE_ARENA_PAGE - 1)
+			& ~(uintptr_t)(FFGE_ARENA_PAGE - 1));
+	a->size = size;
+	madvise(a->base, size, MADV_HUGEPAGE);	/* ignore errors */
+
+	return 0;
+}
+
+struct ffge_arena *ffge_arena_create(size_t size, int node)
+{
+	struct ffge_arena *a = malloc(sizeof *a);
+	if (!a)
+		return nullptr;
+
+	size = (size + FFGE_ARENA_PAGE - 1) / FFGE_ARENA_PAGE * FFGE_ARENA_PAGE;
+	if (size == 0)
+		size = FFGE_ARENA_PAGE;
+	if (ffge_arena_map(a, size) < 0) {
+		free(a);
+		return nullptr;
+	}
+	a->used = 0;
+
+	if (node >= 0 && (size_t)node < 8 * sizeof(unsigned long)) {
+		const unsigned long mask = 1UL << node;
+		/* best effort: ignore errors, e.g. no NUMA support */
+		syscall(SYS_mbind, a->base, a->size, MPOL_PREFERRED,
+			&mask, 8 * sizeof mask, 0);
+	}
+
+	/* touch the memory, so that it is placed local to this thread */
+	const size_t pg = sysconf(_SC_PAGESIZE);
+	for (size_t i = 0; i < a->size; i += pg)
+		((volatile unsigned char *)a->base)[i] = 0;
+
+	return a;
+}
+
+void *ffge_arena_alloc(struct ffge_arena *a, size_t size)
+{
+	size = (size + FFGE_ARENA_ALIGN - 1) / FFGE_ARENA_ALIGN
+		* FFGE_ARENA_ALIGN;
+	if (size > a->size - a->used)
+		return nullptr;
+
+	void *p = a->base + a->used;
+	a->used += size;
+
+	return p;
+}
+
+int64_t *ffge_arena_alloc_i8(struct ffge_arena *a, size_t nr, size_t nc)
+{
+	return ffge_arena_alloc(a, nr * nc * FFGE_WIDTH * sizeof(int64_t));
+}
+
+void ffge_arena_reset(struct ffge_arena *a)
+{
+	a->used = 0;
+}
+
+void ffge_arena_destroy(struct ffge_arena *a)
+{
+	if (!a)
+		return;
+
+	munmap(a->map, a->map_size);
+	free(a);
+}
@@ -0,0 +1,85 @@
+/* -------------------------------------------------------------------------- *
+ * ffge_batch.c: Binary container of a batch of matrices.                     *
+ *                                                                            *
+ * Copyright 2024 Marek Miller & ⧉⧉⧉                                          *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ffge.h"
+#include "ffge_pack.h"
+
+static_assert(sizeof(struct ffge_batch) == 64);
+
+size_t ffge_batch_size(const struct ffge_batch *h)
+{
+	size_t ms, sz;			/* bytes per matrix, total */
+
+	if (memcmp(h->magic, FFGE_BATCH_MAGIC, sizeof h->magic) != 0)
+		return 0;
+	if (h->reserved[0] || h->reserved[1] || h->reserved[2])
+		return 0;
+	if (h->width != 4 && h->width != 8)
+		return 0;
+	if (h->nr == 0 || h->nc == 0 || h->count == 0)
+		return 0;
+	if (__builtin_mul_overflow(h->nr, h->nc, &ms) ||
+			__builtin_mul_overflow(ms, h->width, &ms))
+		return 0;
+
+	switch (h->layout) {
+	case FFGE_BATCH_ROWS:
+		if (__builtin_mul_overflow(ms, h->count, &sz))
+			return 0;
+		break;
+	case FFGE_BATCH_PACKED:
+		if (h->width != 8 || __builtin_mul_overflow(ms,
+				(h->count + FFGE_WIDTH - 1) / FFGE_WIDTH
+					* FFGE_WIDTH, &sz))
+			return 0;
+		break;
+	default:
+		return 0;
+	}
+
+	return sz;
+}
+
+int64_t *ffge_batch_group(const struct ffge_batch *h, void *p, size_t g,
+		int64_t *w)
+{
+	const size_t ne = h->nr * h->nc;
+
+	if (h->layout == FFGE_BATCH_PACKED)
+		return (int64_t *)p + g*ne*FFGE_WIDTH;
+
+	for (size_t k = 0; k < FFGE_WIDTH; k++) {
+		const size_t l = g*FFGE_WIDTH + k;
+		if (l >= h->count) {	/* the identity: a pivot at once */
+			ffge_pack_lane(w, k, h->nr, h->nc, nullptr, 0, 0);
+		} else if (h->width == 8) {
+			ffge_pack_lane(w, k, h->nr, h->nc,
+				(const int64_t *)p + l*ne, h->nr, h->nc);
+		} else {
+			const int32_t *x = (const int32_t *)p + l*ne;
+			for (size_t e = 0; e < ne; e++)
+				w[e*FFGE_WIDTH + k] = x[e];
+		}
+	}
+
+	return w;
+}
@@ -0,0 +1,215 @@
+/* -------------------------------------------------------------------------- *
+ * ffge_gf2.c: Gaussian elimination over GF(2).                               *
+ *                                                                            *
+ * Copyright 2024 Marek Miller & ⧉⧉⧉                                          *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ffge.h"
+
+/* Use the Method of Four Russians for matrices at least that large. */
+#define FFGE_GF2_M4RI_MIN (256)
+/* Number of columns per lookup table.  Two tables are used at once. */
+#define FFGE_GF2_M4RI_K (8)
+
+/* Defined in ffge_gf2_i8.s */
+void ffge_gf2_xor(uint64_t *x, const uint64_t *y, size_t nb);
+void ffge_gf2_xor3(uint64_t *x, const uint64_t *y, const uint64_t *z,
+			size_t nb);
+
+static inline uint64_t ffge_gf2_bit(const uint64_t *r, size_t j)
+{
+	return (r[j / 64] >> (j % 64)) & 1;
+}
+
+static void ffge_gf2_swap(uint64_t *m, size_t st, size_t i1, size_t i2,
+			size_t b)
+{
+	for (size_t j = b*8; j < st; j++) {
+		uint64_t *x, *y, zz;
+		zz = *(x = m + i1*st + j);
+		*x = *(y = m + i2*st + j);
+		*y = zz;
+	}
+}
+
+/* Find the first non-zero element of the row r, starting from column pc.
+ * The row has nc columns.
+ *
+ * Returns the column index, or nc if the rest of the row is zero.
+ */
+static size_t ffge_gf2_lead(const uint64_t *r, size_t pc, size_t nc)
+{
+	size_t w = pc / 64;
+	uint64_t x = r[w] & (~UINT64_C(0) << (pc % 64));
+
+	while (x == 0) {
+		if (++w * 64 >= nc)
+			return nc;
+		x = r[w];
+	}
+	const size_t j = w*64 + __builtin_ctzll(x);
+
+	return j < nc ? j : nc;
+}
+
+/* Bring rows pr, pr+1, ... nr-1 of m to the echelon form, one pivot
+ * at a time.  For each pivot row, pick the row whose leading element
+ * comes first.
+ */
+static size_t ffge_gf2_plain(uint64_t *m, size_t nr, size_t nc, size_t st,
+			size_t pr, size_t pc)
+{
+	const size_t nb = st / 8;
+
+	while (pr < nr && pc < nc) {
+		size_t i, ip = nr, lc = nc;
+		for (i = pr; i < nr && lc > pc; i++) {
+			const size_t j = ffge_gf2_lead(m + i*st, pc, nc);
+			if (j < lc) {
+				ip = i;
+				lc = j;
+			}
+		}
+		if (lc == nc)
+			break;
+		pc = lc;
+
+		const size_t b = pc / 512;
+		if (ip > pr)
+			ffge_gf2_swap(m, st, ip, pr, b);
+		for (i = pr + 1; i < nr; i++)
+			if (ffge_gf2_bit(m + i*st, pc))
+				ffge_gf2_xor(m + i*st + b*8,
+					m + pr*st + b*8, nb - b);
+		pr++;
+		pc++;
+	}
+
+	return pr;
+}
+
+/* Reduce the row r by the pivot rows p[0], ..., p[kk-1] with pivots at
+ * columns cs[0] < cs[1] < ... < cs[kk-1].
+ */
+static void ffge_gf2_reduce(uint64_t *r, const uint64_t *p, size_t st,
+			const size_t *cs, size_t kk, size_t b, size_t nb)
+{
+	for (size_t j = 0; j < kk; j++)
+		if (ffge_gf2_bit(r, cs[j]))
+			ffge_gf2_xor(r + b*8, p + j*st + b*8, nb - b);
+}
+
+/* Fill the table t with all 2^kk sums of the pivot rows p[0], ..., p[kk-1],
+ * such that t[x] is the sum of p[j] for each bit j set in x.
+ */
+static void ffge_gf2_table(uint64_t *t, const uint64_t *p, size_t st,
+			size_t kk, size_t b, size_t nb)
+{
+	memset(t + b*8, 0, (nb - b) * 64);
+	for (size_t x = 1; x < (1UL << kk); x++) {
+		const size_t lo = __builtin_ctzll(x);
+		memcpy(t + x*st + b*8, t + (x & (x - 1))*st + b*8,
+			(nb - b) * 64);
+		ffge_gf2_xor(t + x*st + b*8, p + lo*st + b*8, nb - b);
+	}
+}
+
+/* Method of Four Russians: find up to 2*FFGE_GF2_M4RI_K pivots at a time,
+ * then eliminate them from all the rows below with only one pass of
+ * ffge_gf2_xor3 per row, using two tables of precomputed sums.
+ *
+ * Returns the rank of m, or (size_t)-1 if no memory for tables.
+ */
+static size_t ffge_gf2_m4ri(uint64_t *m, size_t nr, size_t nc, size_t st)
+{
+	const size_t K = FFGE_GF2_M4RI_K, nb = st / 8;
+
+	uint64_t *t1 = aligned_alloc(64, 2 * (1UL << K) * st * sizeof *m);
+	if (!t1)
+		return (size_t)-1;
+	uint64_t *t2 = t1 + (1UL << K) * st;
+
+	size_t pr = 0, pc = 0;
+	while (pr < nr && pc < nc) {
+		const size_t b = pc / 512;
+		uint64_t *p = m + pr*st;
+
+		/* find pivots in the strip of at most 2*K columns */
+		size_t cs[2*FFGE_GF2_M4RI_K], kk = 0, c;
+		for (c = pc; c < nc && kk < 2*K && pr + kk < nr; c++) {
+			size_t i;
+			for (i = pr + kk; i < nr; i++) {
+				uint64_t *r = m + i*st;
+				ffge_gf2_reduce(r, p, st, cs, kk, b, nb);
+				if (ffge_gf2_bit(r, c))
+					break;
+			}
+			if (i == nr)
+				continue;
+			if (i > pr + kk)
+				ffge_gf2_swap(m, st, i, pr + kk, b);
+			cs[kk++] = c;
+		}
+		pc = c;
+		if (kk == 0)
+			continue;
+
+		/* reduce the pivot rows among themselves */
+		for (size_t j = kk; j-- > 0; )
+			for (size_t i = 0; i < j; i++)
+				if (ffge_gf2_bit(p + i*st, cs[j]))
+					ffge_gf2_xor(p + i*st + b*8,
+						p + j*st + b*8, nb - b);
+
+		const size_t k1 = kk < K ? kk : K, k2 = kk - k1;
+		ffge_gf2_table(t1, p, st, k1, b, nb);
+		ffge_gf2_table(t2, p + k1*st, st, k2, b, nb);
+
+		for (size_t i = pr + kk; i < nr; i++) {
+			uint64_t *r = m + i*st;
+			size_t x1 = 0, x2 = 0;
+			for (size_t j = 0; j < k1; j++)
+				x1 |= ffge_gf2_bit(r, cs[j]) << j;
+			for (size_t j = 0; j < k2; j++)
+				x2 |= ffge_gf2_bit(r, cs[k1 + j]) << j;
+
+			if (x1 | x2)
+				ffge_gf2_xor3(r + b*8, t1 + x1*st + b*8,
+					t2 + x2*st + b*8, nb - b);
+		}
+		pr += kk;
+	}
+	free(t1);
+
+	return pr;
+}
+
+size_t ffge_gf2(uint64_t *m, size_t nr, size_t nc)
+{
+	const size_t st = FFGE_GF2_STRIDE(nc);
+
+	if (nr >= FFGE_GF2_M4RI_MIN && nc >= FFGE_GF2_M4RI_MIN) {
+		const size_t rnk = ffge_gf2_m4ri(m, nr, nc, st);
+		if (rnk != (size_t)-1)
+			return rnk;
+	}
+
+	return ffge_gf2_plain(m, nr, nc, st, 0, 0);
+}
@@ -0,0 +1,135 @@
+; --------------------------------------------------------------------------- ;
+; ffge_gf2_i8.s: AVX512 implementation of Gaussian elimination over GF(2).    ;
+;                                                                             ;
+; Copyright 2024 Marek Miller & ⧉⧉⧉                                           ;
+;                                                                             ;
+; This program is free software: you can redistribute it and/or modify it     ;
+; under the terms of the GNU General Public License as published by the       ;
+; Free Software Foundation, either version 3 of the License, or (at your      ;
+; option) any later version.                                                  ;
+;                                                                             ;
+; This program is distributed in the hope that it will be useful, but         ;
+; WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY  ;
+; or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License    ;
+; for more details.                                                           ;
+;                                                                             ;
+; You should have received a copy of the GNU General Public License along     ;
+; with this program.  If not, see <https://www.gnu.org/licenses/>.            ;
+; --------------------------------------------------------------------------- ;
+[bits 64]
+default rel
+
+global ffge_gf2_xor
+global ffge_gf2_xor3
+global ffge_gf2_i8
+
+section .note.GNU-stack
+section .text
+
+;
+; void ffge_gf2_xor(uint64_t *x, const uint64_t *y, size_t nb)
+;
+; Compute x ^= y for nb blocks of 512 bits.
+;
+ffge_gf2_xor:
+	test		rdx, rdx
+	jz		.rt0
+
+.l0:	vmovdqa64	zmm0, [rdi]
+	vpxorq		zmm0, zmm0, [rsi]
+	vmovdqa64	[rdi], zmm0
+
+	add		rdi, 64
+	add		rsi, 64
+	dec		rdx
+	jnz		.l0
+
+	vzeroupper
+.rt0:	ret
+
+;
+; void ffge_gf2_xor3(uint64_t *x, const uint64_t *y, const uint64_t *z,
+;			size_t nb)
+;
+; Compute x ^= y ^ z for nb blocks of 512 bits.
+;
+ffge_gf2_xor3:
+	test		rcx, rcx
+	jz		.rt0
+
+.l0:	vmovdqa64	zmm0, [rdi]
+	vmovdqa64	zmm1, [rsi]
+	vpternlogq	zmm0, zmm1, [rdx], 0x96	; zmm0 ^ zmm1 ^ [rdx]
+	vmovdqa64	[rdi], zmm0
+
+	add		rdi, 64
+	add		rsi, 64
+	add		rdx, 64
+	dec		rcx
+	jnz		.l0
+
+	vzeroupper
+.rt0:	ret
+
+;
+; uint8_t ffge_gf2_i8(uint64_t *m, size_t nr, size_t nc)
+;
+; Each lane keeps the mask of its pivot columns in zmm16.  A row is not yet
+; used as a pivot if it has no bits set in its pivot columns.  The first
+; unused row with the bit c set becomes the pivot of column c, and it is
+; added to all the following unused rows with the bit c set.
+;
+ffge_gf2_i8:
+	xor		rax, rax
+	test		rsi, rsi
+	jz		.rt0
+	test		rdx, rdx
+	jz		.rt0
+
+	; initialize state
+	xor		rcx, rcx		; rcx = c, current column
+	mov		r9, rsi
+	shl		r9, 6
+	add		r9, rdi			; r9 -> m[nr*FFGE_WIDTH]
+	mov		r8, 1
+	vpbroadcastq	zmm18, r8		; zmm18 = 1
+	vpxorq		zmm17, zmm17		; zmm17 = rank
+	vpxorq		zmm16, zmm16		; zmm16 = pivot columns
+
+.l0:	mov		r8, 1
+	shl		r8, cl
+	vpbroadcastq	zmm1, r8		; zmm1 = 1 << c
+	kxorb		k1, k1, k1		; k1 = lanes with pivot found
+	mov		r10, rdi		; r10 -> m[i*FFGE_WIDTH]
+
+.l1:	vmovdqa64	zmm2, [r10]
+	vptestmq	k2, zmm2, zmm1		; bit c set
+	vptestnmq	k3, zmm2, zmm16		; row not used
+	kandb		k2, k2, k3
+	kandb		k3, k2, k1		; k3 = rows to eliminate
+	kandnb		k4, k1, k2		; k4 = new pivot rows
+	korb		k1, k1, k4
+	vmovdqa64	zmm0 {k4}, zmm2		; zmm0 = pivot rows
+	vpxorq		zmm2 {k3}, zmm2, zmm0
+	vmovdqa64	[r10] {k3}, zmm2
+
+	add		r10, 64
+	cmp		r10, r9
+	jb		.l1
+
+	vporq		zmm16 {k1}, zmm16, zmm1
+	vpaddq		zmm17 {k1}, zmm17, zmm18
+
+	inc		rcx
+	cmp		rcx, rdx
+	jb		.l0
+
+	; full rank means rank == min(nr, nc)
+	cmp		rsi, rdx
+	cmova		rsi, rdx
+	vpbroadcastq	zmm1, rsi
+	vpcmpeqq	k1, zmm17, zmm1
+	kmovb		eax, k1
+
+	vzeroupper
+.rt0:	ret
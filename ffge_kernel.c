@@ -0,0 +1,178 @@
+/* -------------------------------------------------------------------------- *
+ * ffge_kernel.c: Kernel basis of a matrix over the prime field Z_p.          *
+ *                                                                            *
+ * Copyright 2024 Marek Miller & ⧉⧉⧉                                          *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ffge.h"
+#include "ffge_mod.h"
+
+size_t ffge_prim_kernel(int64_t *m, size_t nr, size_t nc, int64_t *k)
+{
+	const size_t rnk = ffge_prim(m, nr, nc);
+
+	/* bring the echelon form to the reduced row echelon form */
+	size_t pc;
+	for (size_t r = rnk; r-- > 0; ) {
+		pc = 0;
+		while (m[r*nc + pc] == 0)
+			pc++;
+
+		const int64_t inv = ffge_mod_inv(m[r*nc + pc]);
+		for (size_t j = pc; j < nc; j++)
+			m[r*nc + j] = m[r*nc + j] * inv % FFGE_PRIM;
+
+		for (size_t i = 0; i < r; i++) {
+			const int64_t m_ic = m[i*nc + pc];
+			for (size_t j = pc; j < nc; j++)
+				m[i*nc + j] = (m[i*nc + j] -
+					m[r*nc + j] * m_ic) % FFGE_PRIM;
+		}
+	}
+
+	/* for each free column j, write the kernel vector with v_j = 1 */
+	size_t d = 0, r = 0;
+	for (size_t j = 0; j < nc; j++) {
+		if (r < rnk && m[r*nc + j] != 0) {	/* pivot column */
+			r++;
+			continue;
+		}
+
+		int64_t *v = k + d*nc;
+		for (size_t t = 0; t < nc; t++)
+			v[t] = 0;
+		v[j] = 1;
+		pc = 0;
+		for (size_t i = 0; i < r; i++) {
+			while (m[i*nc + pc] == 0)
+				pc++;
+			v[pc++] = -m[i*nc + j];
+		}
+		d++;
+	}
+
+	return d;
+}
+
+/* Find the next row with non-zero element at pivot column pc of the k-th
+ * packed matrix.  Swap rows, so that the pivot is at the row pr.
+ *
+ * Returns the inverse of the pivot, or 0 if there is no pivot in column pc.
+ */
+static int64_t ffge_kernel_pivot_find_i8(int64_t *m, size_t nr, size_t nc,
+			size_t pr, size_t pc, size_t k)
+{
+	size_t i = pr;
+	while (i < nr && m[(i*nc + pc)*FFGE_WIDTH + k] == 0)
+		i++;
+
+	if (i == nr)
+		return 0;
+	if (i > pr)			/* swap rows */
+		for (size_t j = pc; j < nc; j++) {
+			int64_t *x, *y, zz;
+			zz = *(x = m + (pr*nc + j)*FFGE_WIDTH + k);
+			*x = *(y = m + ( i*nc + j)*FFGE_WIDTH + k);
+			*y = zz;
+		}
+
+	return ffge_mod_inv(m[(pr*nc + pc)*FFGE_WIDTH + k]);
+}
+
+uint8_t ffge_prim_kernel_i8(int64_t *m, size_t nr, size_t nc, int64_t *k,
+			size_t *dim)
+{
+	size_t pr[FFGE_WIDTH];			/* pivot row, i.e. rank */
+	int64_t *r = k;				/* pivot rows, packed */
+
+	for (size_t l = 0; l < FFGE_WIDTH; l++)
+		pr[l] = 0;
+
+	/* Gauss-Jordan elimination; each lane has its own pivot row */
+	for (size_t pc = 0; pc < nc; pc++) {
+		int64_t inv[FFGE_WIDTH];
+		for (size_t l = 0; l < FFGE_WIDTH; l++)
+			inv[l] = ffge_kernel_pivot_find_i8(m, nr, nc,
+							pr[l], pc, l);
+
+		/* gather normalized pivot rows; zero for lanes without pivot */
+		for (size_t j = pc; j < nc; j++)
+			for (size_t l = 0; l < FFGE_WIDTH; l++) {
+				const size_t i = pr[l] < nr ? pr[l] : 0;
+				const int64_t *mi = m + i*nc*FFGE_WIDTH;
+				const int64_t m_ij = mi[j*FFGE_WIDTH + l];
+				r[j*FFGE_WIDTH + l] = ffge_mod_red(m_ij*inv[l]);
+			}
+
+		for (size_t i = 0; i < nr; i++) {
+			int64_t *mi = m + i*nc*FFGE_WIDTH;
+			int64_t m_ic[FFGE_WIDTH];
+			for (size_t l = 0; l < FFGE_WIDTH; l++)
+				m_ic[l] = i == pr[l] ? 0 :
+					mi[pc*FFGE_WIDTH + l];
+
+			for (size_t j = pc; j < nc; j++)
+				for (size_t l = 0; l < FFGE_WIDTH; l++)
+					mi[j*FFGE_WIDTH + l] = ffge_mod_red(
+						mi[j*FFGE_WIDTH + l] -
+						r[j*FFGE_WIDTH + l] * m_ic[l]);
+		}
+
+		for (size_t l = 0; l < FFGE_WIDTH; l++) {
+			if (inv[l] == 0)
+				continue;
+			for (size_t j = pc; j < nc; j++)
+				m[(pr[l]*nc + j)*FFGE_WIDTH + l] =
+					r[j*FFGE_WIDTH + l];
+			pr[l]++;
+		}
+	}
+
+	for (size_t t = 0; t < nc*nc*FFGE_WIDTH; t++)
+		k[t] = 0;
+
+	uint8_t fl = 0;
+	const size_t nm = nr < nc ? nr : nc;
+	for (size_t l = 0; l < FFGE_WIDTH; l++) {
+		if (pr[l] == nm)
+			fl |= 1 << l;
+
+		size_t d = 0, rr = 0;
+		for (size_t j = 0; j < nc; j++) {
+			if (rr < pr[l] &&
+				m[(rr*nc + j)*FFGE_WIDTH + l] != 0) {
+				rr++;
+				continue;
+			}
+
+			int64_t *v = k + d*nc*FFGE_WIDTH + l;
+			v[j*FFGE_WIDTH] = 1;
+			size_t pc = 0;
+			for (size_t i = 0; i < rr; i++) {
+				while (m[(i*nc + pc)*FFGE_WIDTH + l] == 0)
+					pc++;
+				v[pc++*FFGE_WIDTH] =
+					-m[(i*nc + j)*FFGE_WIDTH + l];
+			}
+			d++;
+		}
+		dim[l] = d;
+	}
+
+	return fl;
+}
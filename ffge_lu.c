@@ -0,0 +1,206 @@
+/* -------------------------------------------------------------------------- *
+ * ffge_lu.c: PLU factorization over the prime field Z_p.                     *
+ *                                                                            *
+ * Copyright 2024 Marek Miller & ⧉⧉⧉                                          *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ffge.h"
+#include "ffge_mod.h"
+
+/* Find the next row with non-zero element at pivot column pc. Swap whole
+ * rows, including the multipliers already stored to the left of pc, and
+ * record the swap in p[pr].
+ *
+ * Returns:
+ * 	 0	- if no need for swap or the next pivot row foud.
+ *	-1	- if no pivot row found and the matrix is singular.
+ */
+static int ffge_lu_pivot_find(int64_t *m, size_t *p, size_t n,
+			size_t pr, size_t pc)
+{
+	size_t i = pr;
+	while (i < n && m[i*n + pc] == 0)
+		i++;
+
+	if (i == n)
+		return -1;
+	p[pr] = i;
+	if (i > pr)			/* swap rows i and pr */
+		for (size_t j = 0; j < n; j++) {
+			int64_t *x, *y, zz;
+			zz = *(x = m + pr*n + j);
+			*x = *(y = m +  i*n + j);
+			*y = zz;
+		}
+
+	return 0;
+}
+
+size_t ffge_prim_lu(int64_t *m, size_t *p, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		p[i] = i;
+
+	size_t pc, pr = 0;		/* pivot column, row */
+	for (pc = 0; pc < n; pc++) {
+		if (ffge_lu_pivot_find(m, p, n, pr, pc) < 0)
+			continue;
+
+		const int64_t inv = ffge_mod_inv(m[pr*n + pc]);
+		for (size_t i = pr + 1; i < n; i++) {
+			const int64_t l_ic = m[i*n + pc] * inv % FFGE_PRIM;
+			for (size_t j = pc + 1; j < n; j++)
+				m[i*n + j] =
+				(m[i*n + j] - m[pr*n + j] * l_ic) % FFGE_PRIM;
+
+			m[i*n + pc] = l_ic;
+		}
+		pr++;
+	}
+
+	return pr;
+}
+
+int ffge_prim_lu_solve(const int64_t *m, const size_t *p, size_t n,
+			int64_t *b)
+{
+	for (size_t i = 0; i < n; i++)
+		if (m[i*n + i] == 0)
+			return -1;
+
+	for (size_t i = 0; i < n; i++) {	/* b = P b */
+		int64_t zz = b[i];
+		b[i] = b[p[i]];
+		b[p[i]] = zz;
+	}
+	for (size_t i = 1; i < n; i++)		/* solve L y = b */
+		for (size_t j = 0; j < i; j++)
+			b[i] = (b[i] - m[i*n + j] * b[j]) % FFGE_PRIM;
+	for (size_t i = n; i-- > 0; ) {		/* solve U x = y */
+		for (size_t j = i + 1; j < n; j++)
+			b[i] = (b[i] - m[i*n + j] * b[j]) % FFGE_PRIM;
+		b[i] = b[i] * ffge_mod_inv(m[i*n + i]) % FFGE_PRIM;
+	}
+
+	return 0;
+}
+
+/* Packed version of ffge_lu_pivot_find(), cf. ffge_pivot_find_i8().
+ *
+ * Returns the full-rank flags passed fl with the k-th flag zeroed, if
+ * the k-th matrix has no pivot in column pv.
+ */
+static uint64_t ffge_lu_pivot_find_i8(int64_t *m, size_t *p, size_t n,
+			size_t pv, uint64_t fl)
+{
+	for (size_t k = 0; k < FFGE_WIDTH; k++) {
+		size_t i = pv;
+		while (i < n && m[(i*n + pv)*FFGE_WIDTH + k] == 0)
+			i++;
+
+		if (i == n) {
+			fl &= ~(1 << k);
+			continue;
+		}
+		p[pv*FFGE_WIDTH + k] = i;
+		if (i > pv)			/* swap rows */
+			for (size_t j = 0; j < n; j++) {
+				int64_t *x, *y, zz;
+				zz = *(x = m + (pv*n + j)*FFGE_WIDTH + k);
+				*x = *(y = m + ( i*n + j)*FFGE_WIDTH + k);
+				*y = zz;
+			}
+	}
+
+	return fl;
+}
+
+uint8_t ffge_prim_lu_i8(int64_t *m, size_t *p, size_t n)
+{
+	uint64_t fl = 0xff;
+
+	for (size_t i = 0; i < n; i++)
+		for (size_t k = 0; k < FFGE_WIDTH; k++)
+			p[i*FFGE_WIDTH + k] = i;
+
+	for (size_t pv = 0; pv < n; pv++) {
+		fl = ffge_lu_pivot_find_i8(m, p, n, pv, fl);
+
+		/* A singular matrix has zero pivot, its inverse is zero too,
+		 * and so are the multipliers.  The lane is left unchanged. */
+		int64_t inv[FFGE_WIDTH];
+		for (size_t k = 0; k < FFGE_WIDTH; k++)
+			inv[k] = ffge_mod_inv(m[(pv*n + pv)*FFGE_WIDTH + k]);
+
+		const int64_t *r = m + pv*n*FFGE_WIDTH;
+		for (size_t i = pv + 1; i < n; i++) {
+			int64_t *mi = m + i*n*FFGE_WIDTH;
+			int64_t l_ic[FFGE_WIDTH];
+			for (size_t k = 0; k < FFGE_WIDTH; k++)
+				l_ic[k] = ffge_mod_red(
+					mi[pv*FFGE_WIDTH + k] * inv[k]);
+
+			for (size_t j = pv + 1; j < n; j++)
+				for (size_t k = 0; k < FFGE_WIDTH; k++)
+					mi[j*FFGE_WIDTH + k] = ffge_mod_red(
+						mi[j*FFGE_WIDTH + k] -
+						r[j*FFGE_WIDTH + k] * l_ic[k]);
+
+			for (size_t k = 0; k < FFGE_WIDTH; k++)
+				mi[pv*FFGE_WIDTH + k] = l_ic[k];
+		}
+	}
+
+	return fl;
+}
+
+void ffge_prim_lu_solve_i8(const int64_t *m, const size_t *p, size_t n,
+			int64_t *b)
+{
+	for (size_t i = 0; i < n; i++)		/* b = P b */
+		for (size_t k = 0; k < FFGE_WIDTH; k++) {
+			const size_t pi = p[i*FFGE_WIDTH + k];
+			int64_t zz = b[i*FFGE_WIDTH + k];
+			b[i*FFGE_WIDTH + k] = b[pi*FFGE_WIDTH + k];
+			b[pi*FFGE_WIDTH + k] = zz;
+		}
+
+	for (size_t i = 1; i < n; i++)		/* solve L y = b */
+		for (size_t j = 0; j < i; j++)
+			for (size_t k = 0; k < FFGE_WIDTH; k++)
+				b[i*FFGE_WIDTH + k] = ffge_mod_red(
+					b[i*FFGE_WIDTH + k] -
+					m[(i*n + j)*FFGE_WIDTH + k] *
+						b[j*FFGE_WIDTH + k]);
+
+	for (size_t i = n; i-- > 0; ) {		/* solve U x = y */
+		for (size_t j = i + 1; j < n; j++)
+			for (size_t k = 0; k < FFGE_WIDTH; k++)
+				b[i*FFGE_WIDTH + k] = ffge_mod_red(
+					b[i*FFGE_WIDTH + k] -
+					m[(i*n + j)*FFGE_WIDTH + k] *
+						b[j*FFGE_WIDTH + k]);
+
+		int64_t inv[FFGE_WIDTH];
+		for (size_t k = 0; k < FFGE_WIDTH; k++)
+			inv[k] = ffge_mod_inv(m[(i*n + i)*FFGE_WIDTH + k]);
+		for (size_t k = 0; k < FFGE_WIDTH; k++)
+			b[i*FFGE_WIDTH + k] =
+				ffge_mod_red(b[i*FFGE_WIDTH + k] * inv[k]);
+	}
+}
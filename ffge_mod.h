@@ -0,0 +1,64 @@
+/* -------------------------------------------------------------------------- *
+ * ffge_mod.h: Arithmetic in the prime field Z_p for p = FFGE_PRIM.           *
+ *                                                                            *
+ * Copyright 2024 Marek Miller & ⧉⧉⧉                                          *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#ifndef FFGE_MOD_H
+#define FFGE_MOD_H
+
+#include <stdint.h>
+
+#include "ffge.h"
+
+/*
+ * Compute a % FFGE_PRIM using only addition and bit/logical operations.
+ *
+ * This is the same reduction as the one in ffge_prim_i8.s.  The result
+ * has the sign of a, just like the C operator %.  Loops over packed lanes
+ * that use this function can be vectorized by the compiler.
+ */
+static inline int64_t ffge_mod_red(int64_t a)
+{
+	const int64_t s = a >> 63;		/* 0 or -1 */
+	uint64_t b = (uint64_t)((a ^ s) - s);
+
+	uint64_t r = b & FFGE_PRIM;
+	r += (b >> 31) & FFGE_PRIM;
+	r += (b >> 62) & FFGE_PRIM;
+
+	/* at this point, r <= 2*FFGE_PRIM + 1 = 2^32 - 1 */
+	r += (r >> 31);
+	r &= FFGE_PRIM;
+	r = r == FFGE_PRIM ? 0 : r;
+
+	return ((int64_t)r ^ s) - s;
+}
+
+/* Compute the inverse of a in Z_p as a^(p-2).  The inverse of 0 is 0. */
+static inline int64_t ffge_mod_inv(int64_t a)
+{
+	int64_t r = 1;
+
+	for (uint64_t e = FFGE_PRIM - 2; e > 0; e >>= 1) {
+		if (e & 1)
+			r = ffge_mod_red(r * a);
+		a = ffge_mod_red(a * a);
+	}
+
+	return r;
+}
+
+#endif /* FFGE_MOD_H */
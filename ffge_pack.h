@@ -0,0 +1,42 @@
+/* -------------------------------------------------------------------------- *
+ * ffge_pack.h: Packing of matrices into the lanes of ffge_prim_i8().         *
+ *                                                                            *
+ * Copyright 2024 Marek Miller & ⧉⧉⧉                                          *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#ifndef FFGE_PACK_H
+#define FFGE_PACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ffge.h"
+
+/*
+ * Store the matrix x of size xr by xc in the lane l of w, a packed matrix
+ * of size nr by nc, see ffge_prim_i8().  The rest of the lane is padded
+ * with the identity, and so is the whole lane, if xr or xc is 0.  The
+ * identity finds a pivot at once, so it costs ffge_prim_i8() nothing.
+ */
+static inline void ffge_pack_lane(int64_t *w, size_t l, size_t nr,
+		size_t nc, const int64_t *x, size_t xr, size_t xc)
+{
+	for (size_t i = 0; i < nr; i++)
+		for (size_t j = 0; j < nc; j++)
+			w[(i*nc + j)*FFGE_WIDTH + l] = i < xr && j < xc ?
+				x[i*xc + j] : i == j;
+}
+
+#endif /* FFGE_PACK_H */
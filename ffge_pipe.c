@@ -0,0 +1,288 @@
+/* -------------------------------------------------------------------------- *
+ * ffge_pipe.c: Pipeline of generate, pack, eliminate and collect.            *
+ *                                                                            *
+ * Copyright 2024 Marek Miller & ⧉⧉⧉                                          *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#define _GNU_SOURCE			/* pthread_attr_setaffinity_np */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ffge.h"
+#include "ffge_pack.h"
+#include "ffge_stats.h"
+
+/* Spin this many times on an empty ring before yielding the CPU. */
+#define FFGE_PIPE_SPIN (64)
+
+/* Group of FFGE_WIDTH matrices, passed from stage to stage. */
+struct ffge_pipe_group {
+	int64_t *m;		/* matrices, row by row */
+	int64_t *p;		/* packed for ffge_prim_i8() */
+	void *tag[FFGE_WIDTH];
+	size_t count;		/* matrices in the group */
+	uint8_t fl;
+	bool last;		/* no more groups follow */
+};
+
+/* Single-producer single-consumer ring of group indices.  Every group is
+ * in exactly one ring or stage, so a ring with room for all the groups is
+ * never full: the producer of the inputs waits for a free group instead.
+ */
+struct ffge_pipe_ring {
+	alignas(64) _Atomic size_t head;	/* next to pop */
+	alignas(64) _Atomic size_t tail;	/* next to push */
+	alignas(64) size_t mask;
+	size_t *idx;
+};
+
+struct ffge_pipe {
+	size_t nr, nc;
+	struct ffge_pipe_group *group;
+	/* the input of each stage; the input of FFGE_PIPE_GENERATE holds
+	 * the free groups */
+	struct ffge_pipe_ring ring[FFGE_PIPE_STAGES];
+	ffge_pipe_gen_fn *gen;
+	ffge_pipe_collect_fn *collect;
+	void *data;
+	_Atomic int go;			/* 1 to run, -1 to abort */
+	uint64_t matrices;
+	struct ffge_pipe_stage_stats st[FFGE_PIPE_STAGES];
+};
+
+struct ffge_pipe_arg {
+	struct ffge_pipe *pp;
+	size_t s;
+};
+
+static void ffge_pipe_push(struct ffge_pipe_ring *r, size_t g)
+{
+	const size_t t = atomic_load_explicit(&r->tail, memory_order_relaxed);
+
+	r->idx[t & r->mask] = g;
+	atomic_store_explicit(&r->tail, t + 1, memory_order_release);
+}
+
+/* Pop a group, waiting for one if the ring is empty.  Add the time spent
+ * waiting and the number of groups in the ring to the counters.
+ */
+static size_t ffge_pipe_pop(struct ffge_pipe_ring *r,
+		struct ffge_pipe_stage_stats *st)
+{
+	const size_t h = atomic_load_explicit(&r->head, memory_order_relaxed);
+	size_t t = atomic_load_explicit(&r->tail, memory_order_acquire);
+
+	if (t == h) {
+		const uint64_t t0 = ffge_stats_now();
+		for (size_t i = 0; t == h; i++) {
+			if (i >= FFGE_PIPE_SPIN)
+				sched_yield();
+			t = atomic_load_explicit(&r->tail,
+				memory_order_acquire);
+		}
+		st->wait_ns += ffge_stats_now() - t0;
+	}
+	st->depth += t - h;
+
+	const size_t g = r->idx[h & r->mask];
+	atomic_store_explicit(&r->head, h + 1, memory_order_release);
+
+	return g;
+}
+
+/* Fill the group with inputs. */
+static void ffge_pipe_generate(struct ffge_pipe *pp, struct ffge_pipe_group *g)
+{
+	const size_t ne = pp->nr * pp->nc;
+
+	g->count = 0;
+	g->last = false;
+	while (g->count < FFGE_WIDTH) {
+		if (!pp->gen(g->m + g->count * ne, g->tag + g->count,
+				pp->data)) {
+			g->last = true;
+			break;
+		}
+		g->count++;
+	}
+}
+
+/* Pack the group; pad the unused lanes with the identity. */
+static void ffge_pipe_pack(const struct ffge_pipe *pp,
+		struct ffge_pipe_group *g)
+{
+	const size_t nr = pp->nr, nc = pp->nc;
+
+	for (size_t l = 0; l < FFGE_WIDTH; l++)
+		ffge_pack_lane(g->p, l, nr, nc, g->m + l * nr * nc,
+			l < g->count ? nr : 0, nc);
+}
+
+static void *ffge_pipe_stage(void *arg)
+{
+	struct ffge_pipe *pp = ((struct ffge_pipe_arg *)arg)->pp;
+	const size_t s = ((struct ffge_pipe_arg *)arg)->s;
+	struct ffge_pipe_stage_stats *st = pp->st + s;
+	int go;
+
+	while ((go = atomic_load_explicit(&pp->go, memory_order_acquire)) == 0)
+		sched_yield();
+	if (go < 0)
+		return nullptr;
+
+	for (;;) {
+		const size_t i = ffge_pipe_pop(pp->ring + s, st);
+		struct ffge_pipe_group *g = pp->group + i;
+		const uint64_t t0 = ffge_stats_now();
+
+		switch (s) {
+		case FFGE_PIPE_GENERATE:
+			ffge_pipe_generate(pp, g);
+			break;
+		case FFGE_PIPE_PACK:
+			if (g->count > 0)
+				ffge_pipe_pack(pp, g);
+			break;
+		case FFGE_PIPE_ELIMINATE:
+			if (g->count > 0)
+				g->fl = ffge_prim_i8(g->p, pp->nr, pp->nc);
+			break;
+		case FFGE_PIPE_COLLECT:
+			for (size_t l = 0; l < g->count; l++)
+				pp->collect(g->tag[l], (g->fl >> l) & 1,
+					pp->data);
+			pp->matrices += g->count;
+			break;
+		}
+		st->busy_ns += ffge_stats_now() - t0;
+		st->groups++;
+
+		/* the next stage owns the group once it is pushed */
+		const bool last = g->last;
+		if (s == FFGE_PIPE_COLLECT && last)
+			break;
+		ffge_pipe_push(pp->ring + (s + 1) % FFGE_PIPE_STAGES, i);
+		if (last)
+			break;
+	}
+
+	return nullptr;
+}
+
+static void ffge_pipe_free(struct ffge_pipe *pp)
+{
+	if (pp->group) {
+		free(pp->group[0].m);
+		free(pp->group[0].p);
+	}
+	free(pp->group);
+	for (size_t s = 0; s < FFGE_PIPE_STAGES; s++)
+		free(pp->ring[s].idx);
+}
+
+static int ffge_pipe_init(struct ffge_pipe *pp, size_t groups)
+{
+	const size_t ne = pp->nr * pp->nc * FFGE_WIDTH;
+	size_t cap = 1;
+	while (cap < groups)
+		cap *= 2;
+
+	pp->group = calloc(groups, sizeof *pp->group);
+	for (size_t s = 0; s < FFGE_PIPE_STAGES; s++) {
+		pp->ring[s].idx = malloc(cap * sizeof *pp->ring[s].idx);
+		pp->ring[s].mask = cap - 1;
+		atomic_init(&pp->ring[s].head, 0);
+		atomic_init(&pp->ring[s].tail, 0);
+		if (!pp->ring[s].idx)
+			return -1;
+	}
+	if (!pp->group)
+		return -1;
+	pp->group[0].m = aligned_alloc(64, groups * ne * sizeof(int64_t));
+	pp->group[0].p = aligned_alloc(64, groups * ne * sizeof(int64_t));
+	if (!pp->group[0].m || !pp->group[0].p)
+		return -1;
+
+	for (size_t i = 0; i < groups; i++) {
+		pp->group[i].m = pp->group[0].m + i * ne;
+		pp->group[i].p = pp->group[0].p + i * ne;
+		ffge_pipe_push(pp->ring + FFGE_PIPE_GENERATE, i);
+	}
+
+	return 0;
+}
+
+int ffge_pipe_run(size_t nr, size_t nc, size_t groups, const int *cpu,
+		ffge_pipe_gen_fn *gen, ffge_pipe_collect_fn *collect,
+		void *data, struct ffge_pipe_stats *st)
+{
+	struct ffge_pipe pp = {
+		.nr = nr, .nc = nc,
+		.gen = gen, .collect = collect, .data = data
+	};
+	struct ffge_pipe_arg arg[FFGE_PIPE_STAGES];
+	pthread_t thr[FFGE_PIPE_STAGES];
+	size_t s = 0;
+	int rt = -1;
+
+	atomic_init(&pp.go, 0);
+	if (groups == 0 || ffge_pipe_init(&pp, groups) < 0)
+		goto out;
+
+	const uint64_t t0 = ffge_stats_now();
+	for (; s < FFGE_PIPE_STAGES; s++) {
+		pthread_attr_t attr;
+		if (cpu && cpu[s] >= CPU_SETSIZE)
+			break;
+		if (pthread_attr_init(&attr) != 0)
+			break;
+		if (cpu && cpu[s] >= 0) {
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(cpu[s], &set);
+			if (pthread_attr_setaffinity_np(&attr, sizeof set,
+					&set) != 0) {
+				pthread_attr_destroy(&attr);
+				break;
+			}
+		}
+		arg[s] = (struct ffge_pipe_arg){ .pp = &pp, .s = s };
+		const int err = pthread_create(thr + s, &attr,
+			ffge_pipe_stage, arg + s);
+		pthread_attr_destroy(&attr);
+		if (err != 0)
+			break;
+	}
+	rt = s == FFGE_PIPE_STAGES ? 0 : -1;
+	atomic_store_explicit(&pp.go, rt == 0 ? 1 : -1, memory_order_release);
+	for (size_t k = 0; k < s; k++)
+		pthread_join(thr[k], nullptr);
+
+	if (st && rt == 0) {
+		st->ns = ffge_stats_now() - t0;
+		st->matrices = pp.matrices;
+		memcpy(st->stage, pp.st, sizeof pp.st);
+	}
+out:
+	ffge_pipe_free(&pp);
+
+	return rt;
+}
@@ -0,0 +1,242 @@
+; --------------------------------------------------------------------------- ;
+; ffge_prim16_i32.s: AVX512 implementation of FFGE modulo a 15-bit prime.     ;
+;                                                                             ;
+; Copyright 2024 Marek Miller & ⧉⧉⧉                                           ;
+;                                                                             ;
+; This program is free software: you can redistribute it and/or modify it     ;
+; under the terms of the GNU General Public License as published by the       ;
+; Free Software Foundation, either version 3 of the License, or (at your      ;
+; option) any later version.                                                  ;
+;                                                                             ;
+; This program is distributed in the hope that it will be useful, but         ;
+; WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY  ;
+; or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License    ;
+; for more details.                                                           ;
+;                                                                             ;
+; You should have received a copy of the GNU General Public License along     ;
+; with this program.  If not, see <https://www.gnu.org/licenses/>.            ;
+; --------------------------------------------------------------------------- ;
+[bits 64]
+default rel
+
+global ffge_prim16_i32
+global ffge_prim16_pack
+
+section .rodata
+	FFGE_PRIM16	dw 32749		; 2^15 - 19, a prime
+	FFGE_PRIM16_INV	dw 46565		; FFGE_PRIM16^-1 mod 2^16
+	FFGE_PRIM16_Q	dq 32749		; FFGE_PRIM16, as a quadword
+	FFGE_PRIM16_RCP	dq 0x3f0002605a4d677d	; 1.0 / FFGE_PRIM16, as a double
+	FFGE_2POW52	dq 0x10000000000000	; 2^52
+
+section .note.GNU-stack
+section .text
+	extern ffge_pivot_find_i32
+
+;
+; uint32_t ffge_prim16_i32(uint16_t *m, size_t nr, size_t nc)
+;
+; The products are reduced with Montgomery's REDC for R = 2^16, using only
+; the low and the high halves of 16-bit multiplications.  For a, b < p:
+;
+;     REDC(a*b) = hi(a*b) - hi(lo(a*b*p^-1) * p) = a*b/R mod p,
+;
+; and the result is in (-p, p).  The update of each element becomes
+;
+;     m[i*nc + j] = (m[i*nc + j] * m[pv*nc + pv]
+;			- m[i*nc + pv] * m[pv*nc + j]) / R mod p,
+;
+; i.e. each row is multiplied by a non-zero constant 1/R as well, which
+; does not change the rank of the matrix.
+;
+ffge_prim16_i32:
+	xor		rax, rax
+	test		rsi, rsi
+	jz		.rt0
+	test		rdx, rdx
+	jz		.rt0
+
+	push		r14
+	push		r13
+	push		r12
+
+	; initialize state
+	mov		eax, 0xffffffff		; rax = full-rank flags
+	xor		rcx, rcx		; rcx = pv, current pivot index
+	mov		r14, rsi
+	imul		r14, rdx
+	sub		r14, 1
+	shl		r14, 6
+	add		r14, rdi		; r14 -> m[nr*nc - 1]
+	shl		rdx, 6			; rdx = size of row in bytes
+	mov		r12, rdi		; r12 -> m[pv*nc + pv]
+	mov		r13, rdi
+	add		r13, rdx
+	sub		r13, 64			; r13 -> m[pv*nc + nc - 1]
+
+.l0:	push		rdi
+	push		rsi
+	push		rdx
+	push		rcx
+	shr		rdx, 6
+	mov		r8, rax
+	call		ffge_pivot_find_i32 wrt ..plt
+	pop		rcx
+	pop		rdx
+	pop		rsi
+	pop		rdi
+
+	mov		r11, r12
+	add		r11, rdx		; r11 -> m[i*nc + pv]
+	cmp		r11, r14
+	ja		.rt1			; the pivot is in the last row
+
+	; zmm registers are not preserved across the call
+	vpbroadcastw	zmm14, [FFGE_PRIM16]
+	vpbroadcastw	zmm13, [FFGE_PRIM16_INV]
+	vpxorq		zmm15, zmm15
+
+	cmp		r12, r13
+	je		.l3			; the pivot is in the last column
+
+	vmovdqa64	zmm10, [r12]		; zmm10 = m[pv*nc + pv]
+	vpmullw		zmm0, zmm10, zmm13
+.l1:	vmovdqa64	zmm11, [r11]		; zmm11 = m[i*nc + pv]
+	vpmullw		zmm1, zmm11, zmm13
+	mov		r10, r12
+	add		r10, 64			; r10 -> m[pv*nc + j]
+	mov		r9, r11
+	add		r9, 64			; r9 -> m[i*nc + j]
+.l2:	vmovdqa64	zmm2, [r10]
+	vmovdqa64	zmm3, [r9]
+
+	; compute REDC(m[i*nc + j] * m[pv*nc + pv]) = zmm4 - zmm3
+	vpmulhuw	zmm4, zmm3, zmm10
+	vpmullw		zmm3, zmm3, zmm0
+	vpmulhuw	zmm3, zmm3, zmm14
+
+	; compute REDC(m[i*nc + pv] * m[pv*nc + j]) = zmm5 - zmm2
+	vpmulhuw	zmm5, zmm2, zmm11
+	vpmullw		zmm2, zmm2, zmm1
+	vpmulhuw	zmm2, zmm2, zmm14
+
+	; compute zmm3 = (zmm4 + zmm2) - (zmm5 + zmm3) mod p, where each sum
+	; is in [0, 2p) and is first brought to [0, p) by unsigned minimum
+	vpaddw		zmm4, zmm4, zmm2
+	vpaddw		zmm5, zmm5, zmm3
+	vpsubw		zmm6, zmm4, zmm14
+	vpminuw		zmm4, zmm4, zmm6
+	vpsubw		zmm6, zmm5, zmm14
+	vpminuw		zmm5, zmm5, zmm6
+	vpsubw		zmm3, zmm4, zmm5
+	vpaddw		zmm6, zmm3, zmm14
+	vpminuw		zmm3, zmm3, zmm6
+
+	vmovdqa64	[r9], zmm3
+
+	add		r9, 64
+	add		r10, 64
+	cmp		r10, r13
+	jbe		.l2
+
+	; zero the matrix elements below current diagonal m[pv*nc + pv]
+	vmovdqa64	 [r11], zmm15
+
+	add		r11, rdx
+	cmp		r11, r14
+	jbe		.l1
+
+	inc		rcx
+	add		r13, rdx
+	add		r12, rdx
+	add		r12, 64
+	jmp		.l0
+
+	; zero the last column below the diagonal
+.l3:	vmovdqa64	 [r11], zmm15
+	add		r11, rdx
+	cmp		r11, r14
+	jbe		.l3
+
+.rt1:	pop		r12
+	pop		r13
+	pop		r14
+
+	vzeroupper
+.rt0:	ret
+
+;
+; uint64_t ffge_prim16_pack(uint16_t *w, const int64_t *m, size_t ne)
+;
+; Reduce FFGE_WIDTH16 matrices of ne elements each modulo FFGE_PRIM16, and
+; pack them as in ffge_prim16_i32().  The matrices m are stored as four
+; batches of ne elements, packed as in ffge_prim_i8().  Both w and m must
+; be aligned to the 64 byte boundary.
+;
+; The quotients are computed in double precision, hence the elements must be
+; in the range [-2^52, 2^52).  The function returns 0 if they are, and
+; a non-zero value otherwise, in which case the content of w is undefined.
+;
+; Reduce the elements of zmm%1 and store them at w + %1*16.
+%macro pack16 1
+	; check if -2^52 <= x < 2^52
+	vpaddq		zmm4, zmm%1, zmm12
+	vpsrlq		zmm4, zmm4, 53
+	vporq		zmm11, zmm11, zmm4
+
+	; compute r = x - trunc(x / q) * q, with r in (-2q, 2q)
+	vcvtqq2pd	zmm4, zmm%1
+	vmulpd		zmm4, zmm4, zmm13
+	vcvttpd2qq	zmm4, zmm4
+	vpmullq		zmm4, zmm4, zmm14
+	vpsubq		zmm%1, zmm%1, zmm4
+
+	; bring r to [0, q)
+	vpcmpq		k1, zmm%1, zmm15, 1
+	vpaddq		zmm%1 {k1}, zmm%1, zmm14
+	vpcmpq		k1, zmm%1, zmm15, 1
+	vpaddq		zmm%1 {k1}, zmm%1, zmm14
+	vpcmpq		k1, zmm%1, zmm14, 5
+	vpsubq		zmm%1 {k1}, zmm%1, zmm14
+
+	vpmovqw		oword [rdi + %1*16], zmm%1
+%endmacro
+
+ffge_prim16_pack:
+	xor		rax, rax
+	test		rdx, rdx
+	jz		.rt0
+
+	vpbroadcastq	zmm14, [FFGE_PRIM16_Q]
+	vpbroadcastq	zmm13, [FFGE_PRIM16_RCP]
+	vpbroadcastq	zmm12, [FFGE_2POW52]
+	vpxorq		zmm11, zmm11		; zmm11 = out-of-range bits
+	vpxorq		zmm15, zmm15
+
+	mov		rcx, rdx
+	shl		rcx, 6			; rcx = size of batch in bytes
+	mov		r8, rdx
+	shl		r8, 6
+	add		r8, rdi			; r8 -> w[ne*FFGE_WIDTH16]
+	lea		r9, [rcx + rcx*2]	; r9 = size of three batches
+
+.l0:	vmovdqa64	zmm0, [rsi]
+	vmovdqa64	zmm1, [rsi + rcx]
+	vmovdqa64	zmm2, [rsi + rcx*2]
+	vmovdqa64	zmm3, [rsi + r9]
+
+	pack16		0
+	pack16		1
+	pack16		2
+	pack16		3
+
+	add		rsi, 64
+	add		rdi, 64
+	cmp		rdi, r8
+	jb		.l0
+
+	vptestmq	k1, zmm11, zmm11
+	kmovb		eax, k1
+
+	vzeroupper
+.rt0:	ret
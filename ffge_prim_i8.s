@@ -20,6 +20,8 @@
 default rel
 
 global ffge_prim_i8
+global ffge_prim_i8_stop
+global ffge_schur_i8
 
 section .rodata
 	FFGE_PRIM	dq 0x7fffffff		; 2^31 - 1, a Mersenne prime
@@ -28,85 +30,155 @@ section .note.GNU-stack
 section .text
 	extern ffge_pivot_find_i8
 
+; Compute zmm3 % FFGE_PRIM, with the remainder of the same sign as zmm3.
+; Assume zmm14 holds FFGE_PRIM in each lane, and zmm15 is zero.  Clobber
+; zmm4-zmm7, k3 and k6.
+%macro mod_prim 0
+	vpmovq2m	k3, zmm3
+	vpabsq		zmm4, zmm3
+	vpandq		zmm5, zmm4, zmm14
+	vpsraq		zmm6, zmm4, 31
+	vpandq		zmm7, zmm6, zmm14
+	vpaddq		zmm5, zmm5, zmm7
+	vpsraq		zmm6, zmm4, 62
+	vpandq		zmm7, zmm6, zmm14
+	vpaddq		zmm5, zmm5, zmm7
+	vpsraq		zmm6, zmm5, 31
+	vpaddq		zmm5, zmm5, zmm6
+	vpandq		zmm5, zmm5, zmm14
+	vpsubq		zmm6, zmm5, zmm14
+	vpmovq2m	k6, zmm6
+	vpsubq		zmm5 {k3}, zmm15, zmm5
+	vmovdqa64	zmm3, zmm15
+	vmovdqa64	zmm3 {k6}, zmm5
+%endmacro
+
+%ifdef FFGE_STATS_TSC
+	extern ffge_stats_add_tsc
+
+; Phase timers of the instrumentation build: rbx and r15 hold the TSC ticks
+; spent on the pivot search and on the row updates, rbp holds the last
+; timestamp.
+;
+; Add the ticks elapsed since rbp to %1, and set rbp to the current
+; timestamp.  Preserve rax and rdx.
+%macro tsc_lap 1
+	push		rax
+	push		rdx
+	rdtsc
+	shl		rdx, 32
+	or		rax, rdx
+	add		%1, rax
+	sub		%1, rbp
+	mov		rbp, rax
+	pop		rdx
+	pop		rax
+%endmacro
+%endif
+
 ;
-; uint8_t ffge_prim_i8(int64_t *m, size_t n)
+; uint8_t ffge_prim_i8(int64_t *m, size_t nr, size_t nc)
 ;
 ffge_prim_i8:
+	xor		ecx, ecx		; no stop mask
+
+;
+; uint8_t ffge_prim_i8_stop(int64_t *m, size_t nr, size_t nc, uint8_t stop)
+;
+ffge_prim_i8_stop:
 	xor		rax, rax
 	test		rsi, rsi
 	jz		.rt0
+	test		rdx, rdx
+	jz		.rt0
 
 	push		r14
 	push		r13
 	push		r12
+%ifdef FFGE_STATS_TSC
+	push		rbx
+	push		r15
+	push		rbp
+	sub		rsp, 8			; keep the stack aligned
+	tsc_lap		rbx
+	xor		rbx, rbx
+	xor		r15, r15
+%endif
 
 	; initialize state
-	mov		rax, 0xff		; rax = full-rank flags
+	movzx		eax, cl
+	shl		eax, 8
+	or		eax, 0xff		; rax = full-rank flags, with the
+						; stop mask in bits 8-15
 	xor		rcx, rcx		; rcx = pv, current pivot index
-	mov		rdx, rsi
-	shl		rdx, 6			; rdx = size of row in bytes
-	mov		r12, rdi		; r12 -> m[pv*n + pv]
-	mov		r13, rdi
-	add		r13, rdx
-	sub		r13, 64			; r13 -> m[pv*n + n - 1]
 	mov		r14, rsi
-	imul		r14, rsi
+	imul		r14, rdx
 	sub		r14, 1
 	shl		r14, 6
-	add		r14, rdi		; r14 -> m[n*n - 1]
-	vpbroadcastq	zmm14, [FFGE_PRIM]
-	vpxorq		zmm15, zmm15
+	add		r14, rdi		; r14 -> m[nr*nc - 1]
+	shl		rdx, 6			; rdx = size of row in bytes
+	mov		r12, rdi		; r12 -> m[pv*nc + pv]
+	mov		r13, rdi
+	add		r13, rdx
+	sub		r13, 64			; r13 -> m[pv*nc + nc - 1]
 
-.l0:	push		rdi
+.l0:
+%ifdef FFGE_STATS_TSC
+	tsc_lap		r15
+%endif
+	push		rdi
 	push		rsi
 	push		rdx
 	push		rcx
-	mov		rdx, rcx
-	mov		rcx, rax
+	shr		rdx, 6
+	mov		r8, rax
 	call		ffge_pivot_find_i8 wrt ..plt
 	pop		rcx
 	pop		rdx
 	pop		rsi
 	pop		rdi
+%ifdef FFGE_STATS_TSC
+	tsc_lap		rbx
+%endif
 
-	cmp		r12, r14
-	je		.rt1
+	; stop if all lanes are singular, or any lane of the stop mask is
+	test		al, al
+	jz		.rt1
+	mov		r8d, eax
+	shr		r8d, 8			; r8d = stop mask
+	mov		r9d, eax
+	and		r9d, r8d
+	cmp		r9d, r8d
+	jne		.rt1
 
 	mov		r11, r12
-	add		r11, rdx		; r11 -> m[i*n + pv]
+	add		r11, rdx		; r11 -> m[i*nc + pv]
+	cmp		r11, r14
+	ja		.rt1			; the pivot is in the last row
+
+	; zmm registers are not preserved across the call
+	vpbroadcastq	zmm14, [FFGE_PRIM]
+	vpxorq		zmm15, zmm15
+
+	cmp		r12, r13
+	je		.l3			; the pivot is in the last column
+
 	vmovdqa64	zmm0, [r12]
 .l1:	vmovdqa64	zmm1, [r11]
 	mov		r10, r12
-	add		r10, 64			; r10 -> m[pv*n + j]
+	add		r10, 64			; r10 -> m[pv*nc + j]
 	mov		r9, r11
-	add		r9, 64			; r9 -> m[i*n + j]
+	add		r9, 64			; r9 -> m[i*nc + j]
 .l2:	vmovdqa64	zmm2, [r10]
 	vmovdqa64	zmm3, [r9]
 
 	; compute zmm3 =
-	;     m[i*n + j] * m[pv*n + pv] - m[i*n + pv] * m[pv*n + j]
+	;     m[i*nc + j] * m[pv*nc + pv] - m[i*nc + pv] * m[pv*nc + j]
 	vpmullq		zmm3, zmm3, zmm0
 	vpmullq		zmm2, zmm2, zmm1
 	vpsubq		zmm3, zmm3, zmm2
 
-	; compute zmm3 % FFGE_PRIM
-	vpmovq2m	k3, zmm3
-	vpabsq		zmm4, zmm3
-	vpandq		zmm5, zmm4, zmm14
-	vpsraq		zmm6, zmm4, 31
-	vpandq		zmm7, zmm6, zmm14
-	vpaddq		zmm5, zmm5, zmm7
-	vpsraq		zmm6, zmm4, 62
-	vpandq		zmm7, zmm6, zmm14
-	vpaddq		zmm5, zmm5, zmm7
-	vpsraq		zmm6, zmm5, 31
-	vpaddq		zmm5, zmm5, zmm6
-	vpandq		zmm5, zmm5, zmm14
-	vpsubq		zmm6, zmm5, zmm14
-	vpmovq2m	k6, zmm6
-	vpsubq		zmm5 {k3}, zmm15, zmm5
-	vmovdqa64	zmm3, zmm15
-	vmovdqa64	zmm3 {k6}, zmm5
+	mod_prim
 
 	vmovdqa64	[r9], zmm3
 
@@ -115,7 +187,7 @@ ffge_prim_i8:
 	cmp		r10, r13
 	jbe		.l2
 
-	; zero the matrix elements below current diagonal m[pv*n + pv]
+	; zero the matrix elements below current diagonal m[pv*nc + pv]
 	vmovdqa64	 [r11], zmm15
 
 	add		r11, rdx
@@ -128,8 +200,72 @@ ffge_prim_i8:
 	add		r12, 64
 	jmp		.l0
 
-.rt1:	pop		r12
+	; zero the last column below the diagonal
+.l3:	vmovdqa64	 [r11], zmm15
+	add		r11, rdx
+	cmp		r11, r14
+	jbe		.l3
+
+.rt1:
+%ifdef FFGE_STATS_TSC
+	tsc_lap		r15
+	mov		[rsp], rax
+	mov		rdi, rbx
+	mov		rsi, r15
+	call		ffge_stats_add_tsc wrt ..plt
+	mov		rax, [rsp]
+	add		rsp, 8
+	pop		rbp
+	pop		r15
+	pop		rbx
+%endif
+	pop		r12
 	pop		r13
 	pop		r14
 
 .rt0:	ret
+
+;
+; void ffge_schur_i8(const int64_t *s, size_t r, size_t c, int64_t *d)
+;
+; Write the Schur complement of the pivot s[0] of FFGE_WIDTH packed matrices
+; of r > 1 rows and c > 1 columns to d, as packed matrices of r-1 rows and
+; c-1 columns:
+;
+;     d[(i-1)*(c-1) + j-1] = s[i*c + j] * s[0] - s[i*c] * s[j]  (mod p)
+;
+; The elements of d are written in order, each one after the elements of s
+; it depends on are read.  Hence d can point to the second row of s, i.e.
+; the complement can overwrite s in place, except for the pivot row.
+;
+ffge_schur_i8:
+	vpbroadcastq	zmm14, [FFGE_PRIM]
+	vpxorq		zmm15, zmm15
+
+	shl		rdx, 6			; rdx = size of row in bytes
+	vmovdqa64	zmm0, [rdi]		; zmm0 = s[0]
+	mov		r10, rdi
+	add		r10, rdx		; r10 -> s[i*c]
+	dec		rsi			; rsi = rows left
+
+.l0:	vmovdqa64	zmm1, [r10]
+	mov		r9, 64			; r9 = j*64
+.l1:	vmovdqa64	zmm2, [rdi + r9]
+	vmovdqa64	zmm3, [r10 + r9]
+
+	vpmullq		zmm3, zmm3, zmm0
+	vpmullq		zmm2, zmm2, zmm1
+	vpsubq		zmm3, zmm3, zmm2
+	mod_prim
+
+	vmovdqa64	[rcx], zmm3
+	add		rcx, 64
+	add		r9, 64
+	cmp		r9, rdx
+	jb		.l1
+
+	add		r10, rdx
+	dec		rsi
+	jnz		.l0
+
+	ret
@@ -18,33 +18,137 @@
  * -------------------------------------------------------------------------- */
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "ffge.h"
+#include "ffge_stats.h"
 
-/* Find the next row with non-zero element at pivot column pc. Swap rows.
+/* Find the next row with non-zero element at pivot column pv. Swap rows.
  *
- * The matrix m is in fact packed FFGE_WIDTH matrices, the argument k
- * is the matrix index.
+ * The matrix m is in fact packed FFGE_WIDTH matrices of nr rows and nc
+ * columns, the argument k is the matrix index.
+ *
+ * If nc > nr, a matrix can still have full rank if the whole column pv is
+ * zero below the pivot row.  In that case, look for a non-zero element in
+ * the following columns first, and swap the columns.
  *
  * Returns the full-rank flags passed fl (see docstring for ffge_prim_i8)
  * with the k-th flag zeroed, if the corresponding matrix is singular.
  */
-uint64_t ffge_pivot_find_i8(int64_t *m, size_t n, size_t pv, uint64_t fl)
+uint64_t ffge_pivot_find_i8(int64_t *m, size_t nr, size_t nc, size_t pv,
+			uint64_t fl)
 {
+	FFGE_STATS_ADD(steps, 1);
 	for (size_t k = 0; k < FFGE_WIDTH; k++) {
-		size_t i = pv;
-		while (i < n && m[(i*n + pv)*FFGE_WIDTH + k] == 0)
-			i++;
+		size_t i, c = pv;
+		do {
+			i = pv;
+			while (i < nr && m[(i*nc + c)*FFGE_WIDTH + k] == 0)
+				i++;
+		} while (i == nr && nc > nr && ++c < nc);
 
-		if (i == n) {
+		if (i == nr) {
+			if ((fl >> k) & 1)
+				FFGE_STATS_SINGULAR(pv, 1);
 			fl &= ~(1 << k);
 			continue;
 		}
+		FFGE_STATS_ADD(swaps, (c > pv) + (i > pv));
+		if (c > pv)			/* swap columns */
+			for (size_t r = 0; r < nr; r++) {
+				int64_t *x, *y, zz;
+				zz = *(x = m + (r*nc + pv)*FFGE_WIDTH + k);
+				*x = *(y = m + (r*nc +  c)*FFGE_WIDTH + k);
+				*y = zz;
+			}
 		if (i > pv)			/* swap rows */
-			for (size_t j = pv; j < n; j++) {
+			for (size_t j = pv; j < nc; j++) {
 				int64_t *x, *y, zz;
-				zz = *(x = m + (pv*n + j)*FFGE_WIDTH + k);
-				*x = *(y = m + ( i*n + j)*FFGE_WIDTH + k);
+				zz = *(x = m + (pv*nc + j)*FFGE_WIDTH + k);
+				*x = *(y = m + ( i*nc + j)*FFGE_WIDTH + k);
+				*y = zz;
+			}
+	}
+
+	return fl;
+}
+
+void ffge_schur_i8(const int64_t *s, size_t r, size_t c, int64_t *d);
+
+/* The active submatrix of r rows and c columns is stored contiguously and
+ * shrinks by one row and one column at each step: the Schur complement of
+ * the pivot overwrites the active submatrix past its first row.  The first
+ * step reads m directly, unless a pivot must be swapped into place.  Stop
+ * once all the matrices are found singular.
+ */
+uint8_t ffge_prim_rank_i8(const int64_t *m, size_t nr, size_t nc, int64_t *w)
+{
+	uint64_t fl = 0xff;
+	size_t r = nr, c = nc;
+	const int64_t *s = m;
+	int64_t *d = w;
+
+	if (nr == 0 || nc == 0)
+		return 0;
+
+	for (size_t k = 0; k < FFGE_WIDTH; k++)
+		if (m[k] == 0) {
+			memcpy(w, m, nr * nc * FFGE_WIDTH * sizeof *m);
+			fl = ffge_pivot_find_i8(w, nr, nc, 0, fl);
+			if (fl == 0)
+				return 0;
+			s = w;
+			d = w + nc * FFGE_WIDTH;
+			break;
+		}
+	FFGE_STATS_ADD(steps, s == m);
+
+	while (r > 1 && c > 1) {
+		ffge_schur_i8(s, r, c, d);
+		r--;
+		c--;
+		fl = ffge_pivot_find_i8(d, r, c, 0, fl);
+		if (fl == 0)
+			break;
+		s = d;
+		d += c * FFGE_WIDTH;
+	}
+
+	return fl;
+}
+
+/* Find the next row with non-zero element at pivot column pv. Swap rows.
+ *
+ * Same as ffge_pivot_find_i8(), but for FFGE_WIDTH16 packed matrices with
+ * elements from Z_p for p = FFGE_PRIM16 (see ffge_prim16_i32).
+ */
+uint64_t ffge_pivot_find_i32(uint16_t *m, size_t nr, size_t nc, size_t pv,
+			uint64_t fl)
+{
+	for (size_t k = 0; k < FFGE_WIDTH16; k++) {
+		size_t i, c = pv;
+		do {
+			i = pv;
+			while (i < nr && m[(i*nc + c)*FFGE_WIDTH16 + k] == 0)
+				i++;
+		} while (i == nr && nc > nr && ++c < nc);
+
+		if (i == nr) {
+			fl &= ~(UINT64_C(1) << k);
+			continue;
+		}
+		if (c > pv)			/* swap columns */
+			for (size_t r = 0; r < nr; r++) {
+				uint16_t *x, *y, zz;
+				zz = *(x = m + (r*nc + pv)*FFGE_WIDTH16 + k);
+				*x = *(y = m + (r*nc +  c)*FFGE_WIDTH16 + k);
+				*y = zz;
+			}
+		if (i > pv)			/* swap rows */
+			for (size_t j = pv; j < nc; j++) {
+				uint16_t *x, *y, zz;
+				zz = *(x = m + (pv*nc + j)*FFGE_WIDTH16 + k);
+				*x = *(y = m + ( i*nc + j)*FFGE_WIDTH16 + k);
 				*y = zz;
 			}
 	}
@@ -0,0 +1,237 @@
+/* -------------------------------------------------------------------------- *
+ * ffge_queue.c: Lock-free queue that packs single matrices.                  *
+ *                                                                            *
+ * Copyright 2024 Marek Miller & ⧉⧉⧉                                          *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ffge.h"
+#include "ffge_pack.h"
+#include "ffge_stats.h"
+
+/* Bounded MPMC queue (D. Vyukov): the slot at position pos is free for the
+ * producer if its sequence number is pos, and holds a matrix ready for the
+ * consumer if it is pos + 1.  The consumer returns the slot to the producers
+ * by setting the sequence number to pos + cap.
+ *
+ * A consumer claims up to FFGE_WIDTH consecutive ready slots at once, with
+ * a single compare-and-swap of the head.
+ */
+struct ffge_queue_slot {
+	_Atomic size_t seq;
+	void *tag;
+	/* time of submission, ns; atomic, since a consumer can read it while
+	 * the slot is being reused */
+	_Atomic uint64_t t;
+};
+
+struct ffge_queue {
+	alignas(64) _Atomic size_t head;	/* next slot to dispatch */
+	alignas(64) _Atomic size_t tail;	/* next slot to submit */
+	alignas(64) _Atomic uint64_t submitted;
+	_Atomic uint64_t rejected;
+	alignas(64) _Atomic uint64_t groups;
+	_Atomic uint64_t partial;
+	_Atomic uint64_t lanes;
+
+	alignas(64) size_t nr, nc;
+	size_t mask;		/* capacity - 1 */
+	uint64_t deadline;
+	ffge_queue_fn *fn;
+	void *data;
+	struct ffge_queue_slot *slot;
+	int64_t *m;		/* matrices, nr*nc elements per slot */
+};
+
+struct ffge_queue *ffge_queue_create(size_t nr, size_t nc, size_t cap,
+		uint64_t deadline, ffge_queue_fn *fn, void *data)
+{
+	size_t n = FFGE_WIDTH;
+	while (n < cap)
+		n *= 2;
+
+	struct ffge_queue *q = aligned_alloc(64,
+		(sizeof *q + 63) / 64 * 64);
+	if (!q)
+		return nullptr;
+	q->slot = malloc(n * sizeof *q->slot);
+	q->m = malloc(n * nr * nc * sizeof *q->m);
+	if (!q->slot || !q->m) {
+		free(q->slot);
+		free(q->m);
+		free(q);
+		return nullptr;
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		atomic_init(&q->slot[i].seq, i);
+		atomic_init(&q->slot[i].t, 0);
+	}
+	atomic_init(&q->head, 0);
+	atomic_init(&q->tail, 0);
+	atomic_init(&q->submitted, 0);
+	atomic_init(&q->rejected, 0);
+	atomic_init(&q->groups, 0);
+	atomic_init(&q->partial, 0);
+	atomic_init(&q->lanes, 0);
+
+	q->nr = nr;
+	q->nc = nc;
+	q->mask = n - 1;
+	q->deadline = deadline;
+	q->fn = fn;
+	q->data = data;
+
+	return q;
+}
+
+bool ffge_queue_submit(struct ffge_queue *q, const int64_t *m, void *tag)
+{
+	struct ffge_queue_slot *s;
+	size_t pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+
+	for (;;) {
+		s = q->slot + (pos & q->mask);
+		const size_t seq = atomic_load_explicit(&s->seq,
+					memory_order_acquire);
+		const ptrdiff_t d = (ptrdiff_t)(seq - pos);
+		if (d == 0) {
+			if (atomic_compare_exchange_weak_explicit(&q->tail,
+					&pos, pos + 1, memory_order_relaxed,
+					memory_order_relaxed))
+				break;
+		} else if (d < 0) {
+			atomic_fetch_add_explicit(&q->rejected, 1,
+				memory_order_relaxed);
+			return false;
+		} else {
+			pos = atomic_load_explicit(&q->tail,
+				memory_order_relaxed);
+		}
+	}
+
+	const size_t ne = q->nr * q->nc;
+	memcpy(q->m + (pos & q->mask)*ne, m, ne * sizeof *m);
+	s->tag = tag;
+	atomic_store_explicit(&s->t, ffge_stats_now(), memory_order_relaxed);
+	atomic_store_explicit(&s->seq, pos + 1, memory_order_release);
+	atomic_fetch_add_explicit(&q->submitted, 1, memory_order_relaxed);
+
+	return true;
+}
+
+/* Claim up to FFGE_WIDTH ready slots.  Return the number of slots claimed
+ * and their first position in pos.
+ */
+static size_t ffge_queue_claim(struct ffge_queue *q, bool flush, size_t *pos)
+{
+	size_t p = atomic_load_explicit(&q->head, memory_order_relaxed), k;
+
+	for (;;) {
+		k = 0;
+		while (k < FFGE_WIDTH) {
+			const size_t seq = atomic_load_explicit(
+				&q->slot[(p + k) & q->mask].seq,
+				memory_order_acquire);
+			if (seq != p + k + 1)
+				break;
+			k++;
+		}
+		if (k == 0) {
+			const size_t seq = atomic_load_explicit(
+				&q->slot[p & q->mask].seq,
+				memory_order_relaxed);
+			if ((ptrdiff_t)(seq - (p + 1)) < 0)
+				return 0;	/* empty */
+			/* another consumer took it */
+			p = atomic_load_explicit(&q->head,
+				memory_order_relaxed);
+			continue;
+		}
+		if (k < FFGE_WIDTH && !flush && ffge_stats_now() -
+				atomic_load_explicit(&q->slot[p & q->mask].t,
+					memory_order_relaxed) < q->deadline)
+			return 0;
+		if (atomic_compare_exchange_weak_explicit(&q->head, &p, p + k,
+				memory_order_relaxed, memory_order_relaxed))
+			break;
+	}
+	*pos = p;
+
+	return k;
+}
+
+size_t ffge_queue_poll(struct ffge_queue *q, bool flush, int64_t *w)
+{
+	const size_t nr = q->nr, nc = q->nc, ne = nr * nc;
+	void *tag[FFGE_WIDTH];
+	size_t pos, k;
+
+	if ((k = ffge_queue_claim(q, flush, &pos)) == 0)
+		return 0;
+
+	for (size_t l = 0; l < k; l++) {
+		struct ffge_queue_slot *s = q->slot + ((pos + l) & q->mask);
+		ffge_pack_lane(w, l, nr, nc, q->m + ((pos + l) & q->mask)*ne,
+			nr, nc);
+		tag[l] = s->tag;
+		/* the slot can be reused by the producers */
+		atomic_store_explicit(&s->seq, pos + l + q->mask + 1,
+			memory_order_release);
+	}
+	/* the identity does not cause the pivot search in ffge_prim_i8() */
+	for (size_t l = k; l < FFGE_WIDTH; l++)
+		ffge_pack_lane(w, l, nr, nc, nullptr, 0, 0);
+
+	const uint8_t fl = ffge_prim_i8(w, nr, nc);
+	for (size_t l = 0; l < k; l++)
+		q->fn(tag[l], (fl >> l) & 1, q->data);
+
+	atomic_fetch_add_explicit(&q->groups, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&q->lanes, k, memory_order_relaxed);
+	if (k < FFGE_WIDTH)
+		atomic_fetch_add_explicit(&q->partial, 1,
+			memory_order_relaxed);
+
+	return k;
+}
+
+void ffge_queue_get_stats(const struct ffge_queue *q,
+		struct ffge_queue_stats *st)
+{
+	st->submitted = atomic_load_explicit(&q->submitted,
+				memory_order_relaxed);
+	st->rejected = atomic_load_explicit(&q->rejected, memory_order_relaxed);
+	st->groups = atomic_load_explicit(&q->groups, memory_order_relaxed);
+	st->partial = atomic_load_explicit(&q->partial, memory_order_relaxed);
+	st->lanes = atomic_load_explicit(&q->lanes, memory_order_relaxed);
+}
+
+void ffge_queue_destroy(struct ffge_queue *q)
+{
+	if (!q)
+		return;
+
+	free(q->slot);
+	free(q->m);
+	free(q);
+}
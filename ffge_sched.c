@@ -0,0 +1,119 @@
+/* -------------------------------------------------------------------------- *
+ * ffge_sched.c: Group matrices of different sizes for SIMD.                  *
+ *                                                                            *
+ * Copyright 2024 Marek Miller & ⧉⧉⧉                                          *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "ffge.h"
+#include "ffge_pack.h"
+
+/* Estimated cost of ffge_prim_i8() for matrices of size n: the row updates
+ * plus the pivot search and the loads of each row.
+ */
+#define FFGE_SCHED_COST(n) ((uint64_t)(n) * (n) * ((n) + 16))
+
+/* Pack the k matrices ord[0], ..., ord[k-1] into w as matrices of size nn,
+ * padded with the identity.  The lanes past k hold the identity.
+ */
+static size_t ffge_sched_pack(const int64_t *const *m, const size_t *n,
+		const size_t *ord, size_t k, size_t nn, int64_t *w)
+{
+	size_t padded = 0;
+
+	for (size_t l = 0; l < FFGE_WIDTH; l++) {
+		const int64_t *a = l < k ? m[ord[l]] : nullptr;
+		const size_t nl = l < k ? n[ord[l]] : 0;
+
+		padded += l < k && nl < nn;
+		ffge_pack_lane(w, l, nn, nn, a, nl, nl);
+	}
+
+	return padded;
+}
+
+int ffge_sched_i8(const int64_t *const *m, const size_t *n, size_t count,
+		size_t pad, bool *full, struct ffge_sched_stats *st)
+{
+	struct ffge_sched_stats s = { 0 };
+	size_t nmax = 0;
+	int rt = -1;
+
+	for (size_t l = 0; l < count; l++)
+		if (n[l] > nmax)
+			nmax = n[l];
+
+	size_t *ord = malloc(count * sizeof *ord);
+	size_t *cnt = calloc(nmax + 2, sizeof *cnt);
+	uint64_t *dp = malloc((count + 1) * sizeof *dp);
+	uint8_t *len = malloc(count + 1);
+	int64_t *w = aligned_alloc(64, (nmax*nmax*FFGE_WIDTH * sizeof *w
+				+ 63) / 64 * 64);
+	if (!ord || !cnt || !dp || !len || (nmax > 0 && !w))
+		goto out;
+
+	/* sort by size, stable */
+	for (size_t l = 0; l < count; l++)
+		cnt[n[l] + 1]++;
+	for (size_t i = 1; i < nmax + 2; i++)
+		cnt[i] += cnt[i - 1];
+	for (size_t l = 0; l < count; l++)
+		ord[cnt[n[l]]++] = l;
+
+	/* Let dp[i] be the least cost of the first i matrices in ord, and
+	 * let the last group of them be of len[i] matrices.  The groups are
+	 * contiguous in ord: the cost depends only on the largest size. */
+	dp[0] = 0;
+	for (size_t i = 1; i <= count; i++) {
+		const size_t ni = n[ord[i - 1]];
+		dp[i] = UINT64_MAX;
+		for (size_t k = 1; k <= FFGE_WIDTH && k <= i; k++) {
+			if (ni - n[ord[i - k]] > pad)
+				break;
+			if (dp[i - k] + FFGE_SCHED_COST(ni) < dp[i]) {
+				dp[i] = dp[i - k] + FFGE_SCHED_COST(ni);
+				len[i] = k;
+			}
+		}
+	}
+
+	for (size_t i = count, k; i > 0; i -= k) {
+		const size_t nn = n[ord[i - 1]];
+		k = len[i];
+
+		s.padded += ffge_sched_pack(m, n, ord + i - k, k, nn, w);
+		const uint8_t fl = ffge_prim_i8(w, nn, nn);
+		for (size_t l = 0; l < k; l++)
+			full[ord[i - k + l]] = (fl >> l) & 1;
+
+		s.groups++;
+		s.partial += k < FFGE_WIDTH;
+		s.cost += FFGE_SCHED_COST(nn);
+	}
+	rt = 0;
+out:
+	free(ord);
+	free(cnt);
+	free(dp);
+	free(len);
+	free(w);
+	if (st)
+		*st = s;
+
+	return rt;
+}
@@ -0,0 +1,114 @@
+/* -------------------------------------------------------------------------- *
+ * ffge_screen.c: Screen packed matrices modulo a small prime.                *
+ *                                                                            *
+ * Copyright 2024 Marek Miller & ⧉⧉⧉                                          *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ffge.h"
+
+/* Number of batches of FFGE_WIDTH matrices screened at once */
+#define FFGE_SCREEN_BATCHES (FFGE_WIDTH16 / FFGE_WIDTH)
+
+/* Defined in ffge_prim16_i32.s */
+uint64_t ffge_prim16_pack(uint16_t *w, const int64_t *m, size_t ne);
+
+/* Compute x mod FFGE_PRIM16 in the range 0, 1, ..., FFGE_PRIM16-1, using
+ * only 32-bit divisions by a constant.
+ */
+static inline uint16_t ffge_screen_red(int64_t x)
+{
+	const uint32_t q = FFGE_PRIM16;
+	const uint32_t r32 = (UINT64_C(1) << 32) % q;	/* 2^32 mod q */
+	const uint32_t r64 = (uint64_t)r32 * r32 % q;	/* 2^64 mod q */
+
+	const uint64_t u = x;		/* x + 2^64, if x < 0 */
+	uint32_t r = (uint32_t)(u >> 32) % q * r32 + (uint32_t)u % q;
+	r = r % q + (x < 0 ? q - r64 : 0);
+
+	return r < q ? r : r - q;
+}
+
+/* Reduce the matrices m modulo FFGE_PRIM16 and pack them as in
+ * ffge_prim16_i32().
+ */
+static void ffge_screen_pack16(uint16_t *w, const int64_t *m, size_t ne)
+{
+	if (ffge_prim16_pack(w, m, ne) == 0)
+		return;
+
+	for (size_t e = 0; e < ne; e++)
+		for (size_t b = 0; b < FFGE_SCREEN_BATCHES; b++)
+			for (size_t k = 0; k < FFGE_WIDTH; k++)
+				w[e*FFGE_WIDTH16 + b*FFGE_WIDTH + k] =
+					ffge_screen_red(
+					m[(b*ne + e)*FFGE_WIDTH + k]);
+}
+
+/* Copy the matrix l of m to the lane k of the batch w. */
+static void ffge_screen_copy(int64_t *w, size_t k, const int64_t *m, size_t l,
+			size_t ne)
+{
+	const int64_t *x = m + (l / FFGE_WIDTH)*ne*FFGE_WIDTH + l % FFGE_WIDTH;
+
+	for (size_t e = 0; e < ne; e++)
+		w[e*FFGE_WIDTH + k] = x[e*FFGE_WIDTH];
+}
+
+uint32_t ffge_screen_i32(const int64_t *m, size_t nr, size_t nc, bool exact,
+		int64_t *w, struct ffge_screen_stats *st)
+{
+	const size_t ne = nr * nc;
+	if (ne == 0)
+		return 0;
+
+	ffge_screen_pack16((uint16_t *)w, m, ne);
+	const uint32_t fl16 = ffge_prim16_i32((uint16_t *)w, nr, nc);
+
+	uint32_t fl = fl16;
+	size_t calls = 0, nu = 0, u[FFGE_WIDTH16];
+	if (exact)
+		for (size_t l = 0; l < FFGE_WIDTH16; l++)
+			if (!((fl16 >> l) & 1))
+				u[nu++] = l;
+
+	/* check the uncertain matrices, FFGE_WIDTH at a time */
+	int64_t *w_i8 = w + ne * FFGE_WIDTH;
+	for (size_t b = 0; b < nu; b += FFGE_WIDTH) {
+		const size_t nk = nu - b < FFGE_WIDTH ? nu - b : FFGE_WIDTH;
+
+		/* fill the unused lanes with copies of the first matrix */
+		for (size_t k = 0; k < FFGE_WIDTH; k++)
+			ffge_screen_copy(w_i8, k, m, u[b + (k < nk ? k : 0)],
+				ne);
+		const uint8_t fl8 = ffge_prim_i8(w_i8, nr, nc);
+		for (size_t k = 0; k < nk; k++)
+			fl |= (uint32_t)((fl8 >> k) & 1) << u[b + k];
+		calls++;
+	}
+
+	if (st) {
+		const size_t nf = __builtin_popcount(fl16);
+		st->lanes += FFGE_WIDTH16;
+		st->full += nf;
+		st->checked += nu;
+		st->singular += nu - (__builtin_popcount(fl) - nf);
+		st->calls_i8 += calls;
+	}
+
+	return fl;
+}
@@ -0,0 +1,406 @@
+/* -------------------------------------------------------------------------- *
+ * ffge_sparse.c: Rank of sparse matrices with Markowitz pivoting.            *
+ *                                                                            *
+ * Copyright 2024 Marek Miller & ⧉⧉⧉                                          *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ffge.h"
+
+#define NONE SIZE_MAX
+
+/* Sparse row: columns in increasing order, and the non-zero elements. */
+struct ffge_sp_row {
+	size_t n, cap;
+	size_t *c;
+	int64_t *v;
+};
+
+/* Rows that may have a non-zero element in the column.  The list can be
+ * stale: it is compacted only when the column is searched for a pivot.
+ */
+struct ffge_sp_col {
+	size_t n, cap;
+	size_t *r;
+};
+
+/* Lists of items (rows or columns) of the same degree, i.e. number of
+ * non-zero elements.  Items of degree 0 are not listed.
+ */
+struct ffge_sp_deg {
+	size_t *head;			/* first item of degree d */
+	size_t *next, *prev;
+	size_t *deg;
+	size_t min, max;		/* min is a lower bound */
+	size_t num;			/* items of non-zero degree */
+};
+
+static int ffge_sp_deg_init(struct ffge_sp_deg *d, size_t items, size_t max)
+{
+	d->head = malloc((max + 1) * sizeof *d->head);
+	d->next = malloc(items * sizeof *d->next);
+	d->prev = malloc(items * sizeof *d->prev);
+	d->deg = calloc(items, sizeof *d->deg);
+	if (!d->head || !d->next || !d->prev || !d->deg)
+		return -1;
+
+	for (size_t i = 0; i <= max; i++)
+		d->head[i] = NONE;
+	d->min = max + 1;
+	d->max = max;
+	d->num = 0;
+
+	return 0;
+}
+
+static void ffge_sp_deg_free(struct ffge_sp_deg *d)
+{
+	free(d->head);
+	free(d->next);
+	free(d->prev);
+	free(d->deg);
+}
+
+static void ffge_sp_deg_set(struct ffge_sp_deg *d, size_t x, size_t k)
+{
+	const size_t k0 = d->deg[x];
+
+	if (k0 > 0) {
+		if (d->prev[x] != NONE)
+			d->next[d->prev[x]] = d->next[x];
+		else
+			d->head[k0] = d->next[x];
+		if (d->next[x] != NONE)
+			d->prev[d->next[x]] = d->prev[x];
+		d->num--;
+	}
+	d->deg[x] = k;
+	if (k > 0) {
+		d->prev[x] = NONE;
+		d->next[x] = d->head[k];
+		if (d->head[k] != NONE)
+			d->prev[d->head[k]] = x;
+		d->head[k] = x;
+		if (k < d->min)
+			d->min = k;
+		d->num++;
+	}
+}
+
+/* Return an item of the least non-zero degree, or NONE. */
+static size_t ffge_sp_deg_first(struct ffge_sp_deg *d)
+{
+	while (d->min <= d->max && d->head[d->min] == NONE)
+		d->min++;
+
+	return d->min <= d->max ? d->head[d->min] : NONE;
+}
+
+/* Return the position of column c in the row, or NONE. */
+static size_t ffge_sp_find(const struct ffge_sp_row *row, size_t c)
+{
+	size_t lo = 0, hi = row->n;
+
+	while (lo < hi) {
+		const size_t mid = lo + (hi - lo) / 2;
+		if (row->c[mid] < c)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo < row->n && row->c[lo] == c ? lo : NONE;
+}
+
+static int ffge_sp_col_add(struct ffge_sp_col *col, size_t r)
+{
+	if (col->n == col->cap) {
+		const size_t cap = col->cap ? 2 * col->cap : 4;
+		size_t *p = realloc(col->r, cap * sizeof *p);
+		if (!p)
+			return -1;
+		col->r = p;
+		col->cap = cap;
+	}
+	col->r[col->n++] = r;
+
+	return 0;
+}
+
+struct ffge_sp {
+	size_t nr, nc;
+	struct ffge_sp_row *rows;
+	struct ffge_sp_col *cols;
+	struct ffge_sp_deg rdeg, cdeg;	/* row and column counts */
+	size_t nnz;
+	size_t *mc;			/* merged row, scratch */
+	int64_t *mv;
+	struct ffge_sparse_stats st;
+};
+
+/* Choose a pivot by the Markowitz criterion, i.e. the least (r-1)*(c-1),
+ * where r and c are the counts of the row and the column.  Search only
+ * the column of the least count, and the row of the least count.
+ */
+static void ffge_sp_pivot(struct ffge_sp *s, size_t *pr, size_t *pc)
+{
+	size_t best = NONE;
+
+	const size_t c = ffge_sp_deg_first(&s->cdeg);
+	struct ffge_sp_col *col = s->cols + c;
+	size_t n = 0;
+	for (size_t k = 0; k < col->n; k++) {
+		const size_t i = col->r[k];
+		if (ffge_sp_find(s->rows + i, c) == NONE)
+			continue;
+		col->r[n++] = i;		/* compact the list */
+		const size_t cost = (s->rows[i].n - 1) * (s->cdeg.deg[c] - 1);
+		if (cost < best) {
+			best = cost;
+			*pr = i;
+			*pc = c;
+		}
+	}
+	col->n = n;
+
+	const size_t r = ffge_sp_deg_first(&s->rdeg);
+	const struct ffge_sp_row *row = s->rows + r;
+	for (size_t k = 0; k < row->n; k++) {
+		const size_t j = row->c[k];
+		const size_t cost = (row->n - 1) * (s->cdeg.deg[j] - 1);
+		if (cost < best) {
+			best = cost;
+			*pr = r;
+			*pc = j;
+		}
+	}
+}
+
+static void ffge_sp_col_count(struct ffge_sp *s, size_t j, ptrdiff_t d)
+{
+	ffge_sp_deg_set(&s->cdeg, j, s->cdeg.deg[j] + d);
+}
+
+/* Eliminate column c from all the rows but r, and remove the row r.
+ * Returns 0, or -1 if the memory cannot be allocated.
+ */
+static int ffge_sp_elim(struct ffge_sp *s, size_t r, size_t c)
+{
+	struct ffge_sp_row *pv = s->rows + r;
+	const int64_t a_rc = pv->v[ffge_sp_find(pv, c)];
+	struct ffge_sp_col *col = s->cols + c;
+
+	for (size_t k = 0; k < col->n; k++) {
+		const size_t i = col->r[k];
+		struct ffge_sp_row *row = s->rows + i;
+		size_t p, q = 0, n = 0;
+
+		if (i == r || (p = ffge_sp_find(row, c)) == NONE)
+			continue;
+		const int64_t a_ic = row->v[p];
+
+		/* row i = a_rc * row i - a_ic * row r */
+		for (p = 0; p < row->n || q < pv->n; ) {
+			const size_t ci = p < row->n ? row->c[p] : NONE;
+			const size_t cr = q < pv->n ? pv->c[q] : NONE;
+			int64_t x;
+			if (ci == cr) {
+				x = (row->v[p++] * a_rc - pv->v[q++] * a_ic)
+					% FFGE_PRIM;
+				/* at column c, and at any column that
+				 * cancels out */
+				if (x == 0) {
+					ffge_sp_col_count(s, ci, -1);
+					continue;
+				}
+				s->mc[n] = ci;
+			} else if (ci < cr) {
+				x = row->v[p++] * a_rc % FFGE_PRIM;
+				s->mc[n] = ci;
+			} else {
+				x = -pv->v[q++] * a_ic % FFGE_PRIM;
+				s->mc[n] = cr;
+				if (ffge_sp_col_add(s->cols + cr, i) < 0)
+					return -1;
+				ffge_sp_col_count(s, cr, 1);
+				s->st.fill++;
+			}
+			s->mv[n++] = x;
+		}
+
+		if (n > row->cap) {
+			size_t *pc = realloc(row->c, n * sizeof *pc);
+			if (pc)
+				row->c = pc;
+			int64_t *pv_ = realloc(row->v, n * sizeof *pv_);
+			if (pv_)
+				row->v = pv_;
+			if (!pc || !pv_)
+				return -1;
+			row->cap = n;
+		}
+		memcpy(row->c, s->mc, n * sizeof *s->mc);
+		memcpy(row->v, s->mv, n * sizeof *s->mv);
+		s->nnz = s->nnz - row->n + n;
+		row->n = n;
+		ffge_sp_deg_set(&s->rdeg, i, n);
+	}
+
+	for (size_t q = 0; q < pv->n; q++)
+		ffge_sp_col_count(s, pv->c[q], -1);
+	s->nnz -= pv->n;
+	pv->n = 0;
+	ffge_sp_deg_set(&s->rdeg, r, 0);
+
+	col->n = 0;
+
+	return 0;
+}
+
+/* Copy the active submatrix to a dense matrix and add its rank. */
+static int ffge_sp_dense(struct ffge_sp *s, size_t *rank)
+{
+	const size_t nr = s->rdeg.num, nc = s->cdeg.num;
+	size_t *idx = s->mc, rk;
+	int64_t *m;
+
+	for (size_t j = 0, k = 0; j < s->nc; j++)
+		idx[j] = s->cdeg.deg[j] > 0 ? k++ : NONE;
+	if (!(m = calloc(nr * nc, sizeof *m)))
+		return -1;
+	for (size_t i = 0, k = 0; i < s->nr; i++) {
+		const struct ffge_sp_row *row = s->rows + i;
+		if (row->n == 0)
+			continue;
+		for (size_t q = 0; q < row->n; q++)
+			m[k*nc + idx[row->c[q]]] = row->v[q];
+		k++;
+	}
+	s->st.dense_nr = nr;
+	s->st.dense_nc = nc;
+
+	const int rt = ffge_rank_auto(m, nr, nc, 1, &rk);
+	free(m);
+	if (rt < 0)
+		return -1;
+	*rank += rk;
+
+	return 0;
+}
+
+static int ffge_sp_init(struct ffge_sp *s, const size_t *rp, const size_t *ci,
+		const int64_t *v)
+{
+	const size_t nr = s->nr, nc = s->nc;
+
+	s->rows = calloc(nr, sizeof *s->rows);
+	s->cols = calloc(nc, sizeof *s->cols);
+	s->mc = malloc((nc + 1) * sizeof *s->mc);
+	s->mv = malloc((nc + 1) * sizeof *s->mv);
+	if (!s->rows || !s->cols || !s->mc || !s->mv)
+		return -1;
+	if (ffge_sp_deg_init(&s->rdeg, nr, nc) < 0 ||
+			ffge_sp_deg_init(&s->cdeg, nc, nr) < 0)
+		return -1;
+
+	for (size_t i = 0; i < nr; i++) {
+		struct ffge_sp_row *row = s->rows + i;
+		const size_t n = rp[i + 1] - rp[i];
+		if (n == 0)
+			continue;
+		row->c = malloc(n * sizeof *row->c);
+		row->v = malloc(n * sizeof *row->v);
+		if (!row->c || !row->v)
+			return -1;
+		row->cap = n;
+		for (size_t k = rp[i]; k < rp[i + 1]; k++) {
+			const int64_t x = v[k] % FFGE_PRIM;
+			if (x == 0)
+				continue;
+			if (ffge_sp_col_add(s->cols + ci[k], i) < 0)
+				return -1;
+			ffge_sp_col_count(s, ci[k], 1);
+			row->c[row->n] = ci[k];
+			row->v[row->n++] = x;
+		}
+		ffge_sp_deg_set(&s->rdeg, i, row->n);
+		s->nnz += row->n;
+	}
+
+	return 0;
+}
+
+static void ffge_sp_free(struct ffge_sp *s)
+{
+	if (s->rows)
+		for (size_t i = 0; i < s->nr; i++) {
+			free(s->rows[i].c);
+			free(s->rows[i].v);
+		}
+	if (s->cols)
+		for (size_t j = 0; j < s->nc; j++)
+			free(s->cols[j].r);
+	free(s->rows);
+	free(s->cols);
+	free(s->mc);
+	free(s->mv);
+	ffge_sp_deg_free(&s->rdeg);
+	ffge_sp_deg_free(&s->cdeg);
+}
+
+size_t ffge_sparse_rank(const size_t *rp, const size_t *ci, const int64_t *v,
+		size_t nr, size_t nc, double dense,
+		struct ffge_sparse_stats *st)
+{
+	struct ffge_sp s = { .nr = nr, .nc = nc };
+	size_t rank = 0, r = 0, c = 0;
+	int rt = -1;
+
+	if (nr == 0 || nc == 0) {
+		if (st)
+			*st = (struct ffge_sparse_stats){ 0 };
+		return 0;
+	}
+
+	if (ffge_sp_init(&s, rp, ci, v) < 0)
+		goto out;
+	s.st.nnz_peak = s.nnz;
+
+	while (s.rdeg.num > 0 && s.cdeg.num > 0) {
+		if ((double)s.nnz >= dense * s.rdeg.num * s.cdeg.num) {
+			if (ffge_sp_dense(&s, &rank) < 0)
+				goto out;
+			break;
+		}
+		ffge_sp_pivot(&s, &r, &c);
+		if (ffge_sp_elim(&s, r, c) < 0)
+			goto out;
+		rank++;
+		s.st.pivots++;
+		if (s.nnz > s.st.nnz_peak)
+			s.st.nnz_peak = s.nnz;
+	}
+	rt = 0;
+out:
+	if (st)
+		*st = s.st;
+	ffge_sp_free(&s);
+
+	return rt < 0 ? SIZE_MAX : rank;
+}
@@ -0,0 +1,55 @@
+/* -------------------------------------------------------------------------- *
+ * ffge_stats.c: Statistics of the instrumentation build.                     *
+ *                                                                            *
+ * Copyright 2024 Marek Miller & ⧉⧉⧉                                          *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#define _POSIX_C_SOURCE 200809L		/* clock_gettime */
+
+#include <string.h>
+#include <time.h>
+
+#include "ffge.h"
+#include "ffge_stats.h"
+
+uint64_t ffge_stats_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#ifdef FFGE_STATS
+
+thread_local struct ffge_stats ffge_stats_local;
+
+void ffge_stats_get(struct ffge_stats *st)
+{
+	*st = ffge_stats_local;
+}
+
+void ffge_stats_reset(void)
+{
+	memset(&ffge_stats_local, 0, sizeof ffge_stats_local);
+}
+
+void ffge_stats_add_tsc(uint64_t pivot, uint64_t update)
+{
+	ffge_stats_local.tsc_pivot += pivot;
+	ffge_stats_local.tsc_update += update;
+}
+
+#endif /* FFGE_STATS */
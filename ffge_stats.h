@@ -0,0 +1,77 @@
+/* -------------------------------------------------------------------------- *
+ * ffge_stats.h: Instrumentation of the elimination kernels.                  *
+ *                                                                            *
+ * Copyright 2024 Marek Miller & ⧉⧉⧉                                          *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#ifndef FFGE_STATS_H
+#define FFGE_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ffge.h"
+
+/* Read CLOCK_MONOTONIC, in nanoseconds, for the timings of ffge_pipe_run(),
+ * the deadlines of ffge_queue and the trials of ffge_tune.
+ */
+uint64_t ffge_stats_now(void);
+
+/*
+ * Hooks of the instrumentation build (see struct ffge_stats in ffge.h).
+ * Unless compiled with -DFFGE_STATS, all of them expand to no-ops.
+ *
+ * FFGE_STATS_TIMER(t) declares a TSC timestamp t, and FFGE_STATS_LAP(f, t)
+ * adds the ticks elapsed since t to the field f and resets t.  Both expand
+ * to no-ops, unless compiled with -DFFGE_STATS_TSC as well.
+ */
+#ifdef FFGE_STATS
+
+extern thread_local struct ffge_stats ffge_stats_local;
+
+#define FFGE_STATS_ADD(f, n)	(ffge_stats_local.f += (n))
+
+static inline void ffge_stats_singular(size_t s, uint64_t n)
+{
+	if (s >= FFGE_STATS_STEPS)
+		s = FFGE_STATS_STEPS - 1;
+	ffge_stats_local.singular += n;
+	ffge_stats_local.singular_at[s] += n;
+}
+#define FFGE_STATS_SINGULAR(s, n)	ffge_stats_singular((s), (n))
+
+/* Called from ffge_prim_i8.s */
+void ffge_stats_add_tsc(uint64_t pivot, uint64_t update);
+
+#else
+#define FFGE_STATS_ADD(f, n)		((void)0)
+#define FFGE_STATS_SINGULAR(s, n)	((void)0)
+#endif /* FFGE_STATS */
+
+#if defined(FFGE_STATS) && defined(FFGE_STATS_TSC)
+#include <x86intrin.h>
+
+#define FFGE_STATS_TIMER(t)	uint64_t t = __rdtsc()
+#define FFGE_STATS_LAP(f, t)	do {					\
+		const uint64_t t_ = __rdtsc();				\
+		ffge_stats_local.f += t_ - (t);				\
+		(t) = t_;						\
+	} while (0)
+#else
+#define FFGE_STATS_TIMER(t)		((void)0)
+#define FFGE_STATS_LAP(f, t)		((void)0)
+#endif /* FFGE_STATS_TSC */
+
+#endif /* FFGE_STATS_H */
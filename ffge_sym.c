@@ -0,0 +1,188 @@
+/* -------------------------------------------------------------------------- *
+ * ffge_sym.c: Elimination of symmetric matrices, packed storage.             *
+ *                                                                            *
+ * Copyright 2024 Marek Miller & ⧉⧉⧉                                          *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ffge.h"
+#include "ffge_mod.h"
+#include "ffge_stats.h"
+
+/* Index of the element i,j of a symmetric matrix of size n in the packed
+ * upper triangle.
+ */
+static inline size_t ffge_sym_idx(size_t n, size_t i, size_t j)
+{
+	if (i > j) {
+		const size_t zz = i;
+		i = j;
+		j = zz;
+	}
+
+	return i*(2*n - i + 1)/2 + j - i;
+}
+
+/* Swap rows and columns a < b.  In the rows above the active submatrix,
+ * i.e. the rows of the echelon form, only the columns are swapped.
+ */
+static void ffge_sym_swap(int64_t *m, size_t n, size_t a, size_t b,
+		size_t w, size_t k)
+{
+	for (size_t t = 0; t < n; t++) {
+		if (t == a || t == b)
+			continue;
+		int64_t *x, *y, zz;
+		zz = *(x = m + ffge_sym_idx(n, a, t)*w + k);
+		*x = *(y = m + ffge_sym_idx(n, b, t)*w + k);
+		*y = zz;
+	}
+	int64_t *x, *y, zz;
+	zz = *(x = m + ffge_sym_idx(n, a, a)*w + k);
+	*x = *(y = m + ffge_sym_idx(n, b, b)*w + k);
+	*y = zz;
+}
+
+/* Add row and column l to row and column k.  This is a congruence, hence
+ * the rank is preserved.  In the rows of the echelon form, only column l is
+ * added to column k.
+ */
+static void ffge_sym_add(int64_t *m, size_t n, size_t k, size_t l, size_t w,
+		size_t q)
+{
+	int64_t *a_kk = m + ffge_sym_idx(n, k, k)*w + q;
+	const int64_t a_kl = m[ffge_sym_idx(n, k, l)*w + q];
+	const int64_t a_ll = m[ffge_sym_idx(n, l, l)*w + q];
+
+	*a_kk = (*a_kk + 2*a_kl + a_ll) % FFGE_PRIM;
+	for (size_t t = 0; t < n; t++) {
+		if (t == k)
+			continue;
+		int64_t *x = m + ffge_sym_idx(n, k, t)*w + q;
+		*x = (*x + m[ffge_sym_idx(n, l, t)*w + q]) % FFGE_PRIM;
+	}
+}
+
+/* Bring a non-zero element to the diagonal position pv of the q-th of w
+ * packed matrices (w = 1 for a single matrix).
+ *
+ * Swap a non-zero diagonal element into place.  If the whole diagonal of the
+ * active submatrix is zero, but some element m_kl is not, first add row and
+ * column l to k, which makes m_kk = 2 m_kl non-zero, as p is odd.
+ *
+ * Returns:
+ *	 0	- if a pivot was found.
+ *	-1	- if the active submatrix is zero.
+ */
+static int ffge_sym_pivot_find(int64_t *m, size_t n, size_t pv, size_t w,
+		size_t q)
+{
+	size_t i = pv;
+	while (i < n && m[ffge_sym_idx(n, i, i)*w + q] == 0)
+		i++;
+
+	if (i == n) {
+		size_t k, l = n;
+		for (k = pv; k < n && l == n; k++)
+			for (l = k + 1; l < n; l++)
+				if (m[ffge_sym_idx(n, k, l)*w + q] != 0)
+					break;
+		if (l == n)
+			return -1;
+		ffge_sym_add(m, n, --k, l, w, q);
+		i = k;
+	}
+	if (i > pv) {
+		FFGE_STATS_ADD(swaps, 1);
+		ffge_sym_swap(m, n, pv, i, w, q);
+	}
+
+	return 0;
+}
+
+size_t ffge_sym_prim(int64_t *m, size_t n)
+{
+	size_t pv;
+	for (pv = 0; pv < n; pv++) {
+		FFGE_STATS_ADD(steps, 1);
+		if (ffge_sym_pivot_find(m, n, pv, 1, 0) < 0) {
+			FFGE_STATS_SINGULAR(pv, 1);
+			break;
+		}
+
+		/* the Schur complement of a symmetric matrix is symmetric:
+		 * update the upper triangle only */
+		const int64_t *r = m + ffge_sym_idx(n, pv, pv);
+		for (size_t i = pv + 1; i < n; i++) {
+			int64_t *mi = m + ffge_sym_idx(n, i, i);
+			const int64_t m_pi = r[i - pv];
+			for (size_t j = i; j < n; j++)
+				mi[j - i] = (mi[j - i] * r[0] -
+					r[j - pv] * m_pi) % FFGE_PRIM;
+		}
+	}
+
+	return pv;
+}
+
+/* Update ne elements of the row mi of packed matrices, given the elements
+ * of the pivot row above them, ri, and the pivots m_pp.  The first element
+ * of ri is the multiplier.  The rows do not overlap.
+ */
+static void ffge_sym_update_i8(int64_t *restrict mi,
+		const int64_t *restrict ri, const int64_t *m_pp, size_t ne)
+{
+	int64_t m_pi[FFGE_WIDTH];
+	for (size_t k = 0; k < FFGE_WIDTH; k++)
+		m_pi[k] = ri[k];
+
+	for (size_t j = 0; j < ne; j++)
+		for (size_t k = 0; k < FFGE_WIDTH; k++)
+			mi[j*FFGE_WIDTH + k] = ffge_mod_red(
+				mi[j*FFGE_WIDTH + k] * m_pp[k] -
+				ri[j*FFGE_WIDTH + k] * m_pi[k]);
+}
+
+uint8_t ffge_sym_prim_i8(int64_t *m, size_t n)
+{
+	uint64_t fl = 0xff;
+
+	for (size_t pv = 0; pv < n && fl != 0; pv++) {
+		FFGE_STATS_ADD(steps, 1);
+		for (size_t k = 0; k < FFGE_WIDTH; k++)
+			if (m[ffge_sym_idx(n, pv, pv)*FFGE_WIDTH + k] == 0 &&
+					(fl >> k) & 1 &&
+					ffge_sym_pivot_find(m, n, pv,
+						FFGE_WIDTH, k) < 0) {
+				FFGE_STATS_SINGULAR(pv, 1);
+				fl &= ~(1 << k);
+			}
+
+		const int64_t *r = m + ffge_sym_idx(n, pv, pv)*FFGE_WIDTH;
+		int64_t m_pp[FFGE_WIDTH];
+		for (size_t k = 0; k < FFGE_WIDTH; k++)
+			m_pp[k] = r[k];
+
+		for (size_t i = pv + 1; i < n; i++) {
+			int64_t *mi = m + ffge_sym_idx(n, i, i)*FFGE_WIDTH;
+			ffge_sym_update_i8(mi, r + (i - pv)*FFGE_WIDTH, m_pp,
+				n - i);
+		}
+	}
+
+	return fl;
+}
@@ -0,0 +1,327 @@
+/* -------------------------------------------------------------------------- *
+ * ffge_tune.c: Autotuner and dispatcher of the rank kernels.                 *
+ *                                                                            *
+ * Copyright 2024 Marek Miller & ⧉⧉⧉                                          *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#include "ffge.h"
+#include "ffge_pack.h"
+#include "ffge_stats.h"
+
+enum {
+	FFGE_TUNE_PRIM,
+	FFGE_TUNE_PRIM_I8,
+	FFGE_TUNE_KERNEL_I8,
+	FFGE_TUNE_KERNELS
+};
+
+static const char *const FFGE_TUNE_NAMES[FFGE_TUNE_KERNELS] = {
+	"ffge_prim",
+	"ffge_prim_i8",
+	"ffge_prim_kernel_i8",
+};
+
+/* Grid of the plan.  The size of the matrices, max(nr, nc), is rounded up
+ * to the grid, and the number of matrices is rounded down.
+ */
+static const size_t FFGE_TUNE_N[] = {
+	2, 3, 4, 5, 6, 8, 10, 12, 16, 20, 24, 32, 48, 64
+};
+static const size_t FFGE_TUNE_COUNT[] = { 1, 2, 4, 8, 16, 64 };
+#define FFGE_TUNE_NN (sizeof FFGE_TUNE_N / sizeof *FFGE_TUNE_N)
+#define FFGE_TUNE_NC (sizeof FFGE_TUNE_COUNT / sizeof *FFGE_TUNE_COUNT)
+
+#define FFGE_TUNE_HEADER "# ffge plan 1\n"
+#define FFGE_TUNE_NS (200000)	/* measure for at least 200 us */
+#define FFGE_TUNE_TRIES (3)
+
+/* Scratch space on the stack, enough for ffge_prim_kernel_i8() and matrices
+ * of size 16.
+ */
+#define FFGE_TUNE_STACK (2 * 16 * 16 * FFGE_WIDTH)
+
+static uint8_t ffge_plan[FFGE_TUNE_NN][FFGE_TUNE_NC];
+static once_flag ffge_plan_once = ONCE_FLAG_INIT;
+
+static void ffge_plan_default(uint8_t plan[FFGE_TUNE_NN][FFGE_TUNE_NC])
+{
+	for (size_t i = 0; i < FFGE_TUNE_NN; i++)
+		for (size_t j = 0; j < FFGE_TUNE_NC; j++)
+			plan[i][j] = FFGE_TUNE_COUNT[j] > 1 ?
+				FFGE_TUNE_PRIM_I8 : FFGE_TUNE_PRIM;
+}
+
+static int ffge_plan_read(const char *path)
+{
+	uint8_t plan[FFGE_TUNE_NN][FFGE_TUNE_NC];
+	char line[256], name[64];
+	size_t n, count;
+	int rt = -1;
+
+	FILE *f = fopen(path, "r");
+	if (!f)
+		return -1;
+	if (!fgets(line, sizeof line, f) || strcmp(line, FFGE_TUNE_HEADER))
+		goto out;
+
+	ffge_plan_default(plan);
+	while (fgets(line, sizeof line, f)) {
+		size_t i = 0, j = 0, k = 0;
+
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		if (sscanf(line, "%zu %zu %63s", &n, &count, name) != 3)
+			goto out;
+		while (i < FFGE_TUNE_NN && FFGE_TUNE_N[i] != n)
+			i++;
+		while (j < FFGE_TUNE_NC && FFGE_TUNE_COUNT[j] != count)
+			j++;
+		while (k < FFGE_TUNE_KERNELS &&
+				strcmp(FFGE_TUNE_NAMES[k], name) != 0)
+			k++;
+		if (k == FFGE_TUNE_KERNELS)
+			goto out;
+		if (i < FFGE_TUNE_NN && j < FFGE_TUNE_NC)
+			plan[i][j] = k;
+	}
+	memcpy(ffge_plan, plan, sizeof plan);
+	rt = 0;
+out:
+	fclose(f);
+
+	return rt;
+}
+
+static void ffge_plan_init(void)
+{
+	const char *path = getenv("FFGE_PLAN");
+
+	ffge_plan_default(ffge_plan);
+	ffge_plan_read(path ? path : FFGE_PLAN_DEFAULT);
+}
+
+int ffge_plan_load(const char *path)
+{
+	call_once(&ffge_plan_once, ffge_plan_init);
+
+	return ffge_plan_read(path);
+}
+
+static unsigned ffge_plan_lookup(size_t nr, size_t nc, size_t count)
+{
+	const size_t n = nr > nc ? nr : nc;
+	size_t i = 0, j = FFGE_TUNE_NC - 1;
+
+	call_once(&ffge_plan_once, ffge_plan_init);
+	while (i < FFGE_TUNE_NN - 1 && FFGE_TUNE_N[i] < n)
+		i++;
+	while (j > 0 && FFGE_TUNE_COUNT[j] > count)
+		j--;
+
+	return ffge_plan[i][j];
+}
+
+const char *ffge_rank_auto_kernel(size_t nr, size_t nc, size_t count)
+{
+	return FFGE_TUNE_NAMES[ffge_plan_lookup(nr, nc, count)];
+}
+
+/* Pack k matrices of ne = nr*nc elements, stored one after another, into w.
+ * The lanes past k hold the identity.
+ */
+static void ffge_tune_pack(const int64_t *m, size_t nr, size_t nc, size_t k,
+		int64_t *w)
+{
+	for (size_t l = 0; l < FFGE_WIDTH; l++)
+		ffge_pack_lane(w, l, nr, nc, l < k ? m + l*nr*nc : nullptr,
+			l < k ? nr : 0, nc);
+}
+
+static int ffge_rank_run(unsigned kern, const int64_t *m, size_t nr,
+		size_t nc, size_t count, size_t *rank)
+{
+	alignas(64) int64_t buf[FFGE_TUNE_STACK];
+	const size_t ne = nr * nc, nm = nr < nc ? nr : nc;
+	const size_t need = kern == FFGE_TUNE_PRIM ? ne :
+		(ne + nc*nc) * FFGE_WIDTH;
+	int64_t *w = buf, *heap = nullptr;
+
+	if (need > FFGE_TUNE_STACK) {
+		w = heap = aligned_alloc(64,
+			(need * sizeof *w + 63) / 64 * 64);
+		if (!heap)
+			return -1;
+	}
+
+	switch (kern) {
+	case FFGE_TUNE_PRIM:
+		for (size_t l = 0; l < count; l++) {
+			memcpy(w, m + l*ne, ne * sizeof *w);
+			rank[l] = ffge_prim(w, nr, nc);
+		}
+		break;
+	case FFGE_TUNE_PRIM_I8:
+		for (size_t g = 0; g < count; g += FFGE_WIDTH) {
+			const size_t k = count - g < FFGE_WIDTH ?
+				count - g : FFGE_WIDTH;
+			ffge_tune_pack(m + g*ne, nr, nc, k, w);
+			const uint8_t fl = ffge_prim_i8(w, nr, nc);
+			for (size_t l = 0; l < k; l++) {
+				if ((fl >> l) & 1) {
+					rank[g + l] = nm;
+					continue;
+				}
+				/* the packed matrix is destroyed, start over */
+				memcpy(w, m + (g + l)*ne, ne * sizeof *w);
+				rank[g + l] = ffge_prim(w, nr, nc);
+			}
+		}
+		break;
+	case FFGE_TUNE_KERNEL_I8:
+		for (size_t g = 0; g < count; g += FFGE_WIDTH) {
+			const size_t k = count - g < FFGE_WIDTH ?
+				count - g : FFGE_WIDTH;
+			size_t dim[FFGE_WIDTH];
+			ffge_tune_pack(m + g*ne, nr, nc, k, w);
+			ffge_prim_kernel_i8(w, nr, nc, w + ne*FFGE_WIDTH, dim);
+			for (size_t l = 0; l < k; l++)
+				rank[g + l] = nc - dim[l];
+		}
+		break;
+	}
+	free(heap);
+
+	return 0;
+}
+
+int ffge_rank_auto(const int64_t *m, size_t nr, size_t nc, size_t count,
+		size_t *rank)
+{
+	if (count == 0)
+		return 0;
+
+	return ffge_rank_run(ffge_plan_lookup(nr, nc, count), m, nr, nc,
+		count, rank);
+}
+
+/* Fill m with count random matrices of size n, half of them singular. */
+static void ffge_tune_gen(int64_t *m, size_t n, size_t count)
+{
+	uint64_t x = 0x9e3779b97f4a7c15 * (n + 1);
+
+	for (size_t l = 0; l < count; l++) {
+		int64_t *a = m + l*n*n;
+		for (size_t e = 0; e < n*n; e++) {
+			/* splitmix64 */
+			uint64_t z = (x += 0x9e3779b97f4a7c15);
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+			a[e] = (z ^ (z >> 31)) % FFGE_PRIM;
+		}
+		if (l % 2)
+			memcpy(a + (n - 1)*n, a, n * sizeof *a);
+	}
+}
+
+/* Return the time of the kernel per matrix in ns, or -1 on error. */
+static double ffge_tune_time(unsigned kern, const int64_t *m, size_t n,
+		size_t count, size_t *rank)
+{
+	double best = -1;
+
+	for (int t = 0; t < FFGE_TUNE_TRIES; t++) {
+		size_t reps = 0;
+		const uint64_t t0 = ffge_stats_now();
+		uint64_t dt;
+		do {
+			if (ffge_rank_run(kern, m, n, n, count, rank) < 0)
+				return -1;
+			reps++;
+		} while ((dt = ffge_stats_now() - t0) < FFGE_TUNE_NS);
+
+		const double ns = (double)dt / reps / count;
+		if (best < 0 || ns < best)
+			best = ns;
+	}
+
+	return best;
+}
+
+int ffge_tune(const char *path)
+{
+	const size_t nmax = FFGE_TUNE_N[FFGE_TUNE_NN - 1];
+	const size_t cmax = FFGE_TUNE_COUNT[FFGE_TUNE_NC - 1];
+	uint8_t plan[FFGE_TUNE_NN][FFGE_TUNE_NC];
+	double ns[FFGE_TUNE_NN][FFGE_TUNE_NC];
+	int rt = -1;
+
+	int64_t *m = malloc(nmax * nmax * cmax * sizeof *m);
+	size_t *rank = malloc(cmax * sizeof *rank);
+	if (!m || !rank)
+		goto out;
+
+	for (size_t i = 0; i < FFGE_TUNE_NN; i++) {
+		const size_t n = FFGE_TUNE_N[i];
+		ffge_tune_gen(m, n, cmax);
+		for (size_t j = 0; j < FFGE_TUNE_NC; j++) {
+			ns[i][j] = -1;
+			for (unsigned k = 0; k < FFGE_TUNE_KERNELS; k++) {
+				const double t = ffge_tune_time(k, m, n,
+					FFGE_TUNE_COUNT[j], rank);
+				if (t < 0)
+					goto out;
+				if (ns[i][j] < 0 || t < ns[i][j]) {
+					ns[i][j] = t;
+					plan[i][j] = k;
+				}
+			}
+		}
+	}
+
+	call_once(&ffge_plan_once, ffge_plan_init);
+	memcpy(ffge_plan, plan, sizeof plan);
+	rt = 0;
+
+	if (path) {
+		FILE *f = fopen(path, "w");
+		if (!f) {
+			rt = -1;
+			goto out;
+		}
+		fputs(FFGE_TUNE_HEADER, f);
+		fputs("# n count kernel ns/matrix\n", f);
+		for (size_t i = 0; i < FFGE_TUNE_NN; i++)
+			for (size_t j = 0; j < FFGE_TUNE_NC; j++)
+				fprintf(f, "%zu %zu %s %.1f\n", FFGE_TUNE_N[i],
+					FFGE_TUNE_COUNT[j],
+					FFGE_TUNE_NAMES[plan[i][j]], ns[i][j]);
+		if (fclose(f) != 0)
+			rt = -1;
+	}
+out:
+	free(m);
+	free(rank);
+
+	return rt;
+}
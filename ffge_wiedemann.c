@@ -0,0 +1,457 @@
+/* -------------------------------------------------------------------------- *
+ * ffge_wiedemann.c: Rank of sparse matrices by the Wiedemann algorithm.      *
+ *                                                                            *
+ * Copyright 2024 Marek Miller & ⧉⧉⧉                                          *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#include "ffge.h"
+#include "ffge_mod.h"
+
+/* A lane stops once its generator has predicted this many terms of the
+ * sequence in a row, past twice its degree.
+ */
+#define FFGE_WIED_EARLY (16)
+
+/* Fold a < 2^63 to a smaller number congruent modulo FFGE_PRIM = 2^31 - 1,
+ * less than 2^33.  An accumulator kept below 2^33 can take a product of
+ * two elements of Z_p and be folded again.
+ */
+static inline uint64_t ffge_wied_fold(uint64_t a)
+{
+	return (a & FFGE_PRIM) + (a >> 31);
+}
+
+/* Elements in [0, p) from splitmix64, never 0 if nonzero is set. */
+static int64_t ffge_wied_rand(uint64_t *st, bool nonzero)
+{
+	uint64_t z;
+	do {
+		z = (*st += UINT64_C(0x9e3779b97f4a7c15));
+		z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+		z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+		z = (z ^ (z >> 31)) % FFGE_PRIM;
+	} while (nonzero && z == 0);
+
+	return z;
+}
+
+struct ffge_wied_csr {
+	size_t *rp, *ci;
+	int64_t *v;		/* in [0, p) */
+};
+
+/* Berlekamp-Massey state of one lane: the connection polynomial c of
+ * degree at most l, and the polynomial b from the last change of l.
+ */
+struct ffge_wied_bm {
+	int64_t *c, *b, *t;
+	size_t l, lb, m, zeros;
+	int64_t db_inv;
+	bool done;
+};
+
+struct ffge_wied_barrier {
+	mtx_t mtx;
+	cnd_t cnd;
+	size_t n, count, gen;
+	bool go;		/* all the threads are created */
+};
+
+struct ffge_wied {
+	size_t nr, nc, nt;
+	struct ffge_wied_csr p, q;	/* D2 A D1 and D1 A^T */
+	size_t *p_split, *q_split;	/* rows of each thread */
+	int64_t *x, *y, *w, *u;		/* packed, FFGE_WIDTH lanes */
+	int64_t *s;			/* sequence u^T B^k x */
+	uint64_t *dot;			/* partial u^T w of each thread */
+	size_t kmax, steps;
+	struct ffge_wied_bm bm[FFGE_WIDTH];
+	struct ffge_wied_barrier bar;
+};
+
+struct ffge_wied_arg {
+	struct ffge_wied *wd;
+	size_t t;
+};
+
+static void ffge_wied_barrier_wait(struct ffge_wied_barrier *b)
+{
+	if (b->n == 1)
+		return;
+
+	mtx_lock(&b->mtx);
+	const size_t gen = b->gen;
+	if (++b->count == b->n) {
+		b->count = 0;
+		b->gen++;
+		cnd_broadcast(&b->cnd);
+	} else {
+		while (gen == b->gen)
+			cnd_wait(&b->cnd, &b->mtx);
+	}
+	mtx_unlock(&b->mtx);
+}
+
+/* Compute y = A x for the rows r0, ..., r1 - 1 of A, for all the lanes of
+ * x at once.  The elements of A and x are in [0, p), and so is y.
+ */
+static void ffge_wied_spmv(const size_t *restrict rp,
+		const size_t *restrict ci, const int64_t *restrict v,
+		size_t r0, size_t r1, const int64_t *restrict x,
+		int64_t *restrict y)
+{
+	for (size_t i = r0; i < r1; i++) {
+		uint64_t acc[FFGE_WIDTH] = { 0 };
+		for (size_t k = rp[i]; k < rp[i + 1]; k++) {
+			const uint64_t a = v[k];
+			const int64_t *xj = x + ci[k] * FFGE_WIDTH;
+			for (size_t l = 0; l < FFGE_WIDTH; l++)
+				acc[l] = ffge_wied_fold(acc[l] +
+					a * (uint64_t)xj[l]);
+		}
+		for (size_t l = 0; l < FFGE_WIDTH; l++)
+			y[i * FFGE_WIDTH + l] = ffge_mod_red(acc[l]);
+	}
+}
+
+/* Compute the lanes of u^T w for the rows r0, ..., r1 - 1, folded. */
+static void ffge_wied_dot(const int64_t *restrict u,
+		const int64_t *restrict w, size_t r0, size_t r1,
+		uint64_t *restrict dot)
+{
+	uint64_t acc[FFGE_WIDTH] = { 0 };
+
+	for (size_t i = r0; i < r1; i++)
+		for (size_t l = 0; l < FFGE_WIDTH; l++)
+			acc[l] = ffge_wied_fold(acc[l] + (uint64_t)
+				u[i * FFGE_WIDTH + l] * w[i * FFGE_WIDTH + l]);
+	for (size_t l = 0; l < FFGE_WIDTH; l++)
+		dot[l] = acc[l];
+}
+
+/* Feed the k-th term of the sequence of the lane to Berlekamp-Massey. */
+static void ffge_wied_bm_step(struct ffge_wied *wd, size_t lane, size_t k)
+{
+	struct ffge_wied_bm *bm = wd->bm + lane;
+	const int64_t *s = wd->s + lane;
+	uint64_t d = s[k * FFGE_WIDTH];
+
+	for (size_t i = 1; i <= bm->l; i++)
+		d = ffge_wied_fold(d + (uint64_t)bm->c[i] *
+			s[(k - i) * FFGE_WIDTH]);
+	d = ffge_mod_red(d);
+
+	if (d == 0) {
+		bm->m++;
+		bm->zeros++;
+		if (bm->zeros >= FFGE_WIED_EARLY &&
+				k + 1 >= 2 * bm->l + FFGE_WIED_EARLY)
+			bm->done = true;
+		return;
+	}
+
+	/* c = c - d/db x^m b */
+	const int64_t coef = FFGE_PRIM - ffge_mod_red((int64_t)d * bm->db_inv);
+	const bool grow = 2 * bm->l <= k;
+	if (grow)
+		memcpy(bm->t, bm->c, (bm->l + 1) * sizeof *bm->t);
+	for (size_t i = 0; i <= bm->lb; i++)
+		bm->c[i + bm->m] = ffge_mod_red(bm->c[i + bm->m] +
+			coef * bm->b[i]);
+	if (grow) {
+		int64_t *t = bm->b;
+		bm->b = bm->t;
+		bm->t = t;
+		bm->lb = bm->l;
+		bm->l = k + 1 - bm->l;
+		bm->db_inv = ffge_mod_inv(d);
+		bm->m = 1;
+	} else {
+		bm->m++;
+	}
+	bm->zeros = 0;
+}
+
+static int ffge_wied_run(void *arg)
+{
+	const struct ffge_wied_arg *a = arg;
+	struct ffge_wied *wd = a->wd;
+	const size_t t = a->t;
+	int64_t *x = wd->x, *w = wd->w;
+
+	mtx_lock(&wd->bar.mtx);
+	while (!wd->bar.go)
+		cnd_wait(&wd->bar.cnd, &wd->bar.mtx);
+	mtx_unlock(&wd->bar.mtx);
+
+	for (size_t k = 1; k < wd->kmax; k++) {
+		ffge_wied_spmv(wd->p.rp, wd->p.ci, wd->p.v,
+			wd->p_split[t], wd->p_split[t + 1], x, wd->y);
+		ffge_wied_barrier_wait(&wd->bar);
+
+		ffge_wied_spmv(wd->q.rp, wd->q.ci, wd->q.v,
+			wd->q_split[t], wd->q_split[t + 1], wd->y, w);
+		ffge_wied_dot(wd->u, w, wd->q_split[t], wd->q_split[t + 1],
+			wd->dot + t * FFGE_WIDTH);
+		ffge_wied_barrier_wait(&wd->bar);
+
+		for (size_t l = t; l < FFGE_WIDTH; l += wd->nt) {
+			uint64_t s = 0;
+			for (size_t j = 0; j < wd->nt; j++)
+				s = ffge_wied_fold(s +
+					wd->dot[j * FFGE_WIDTH + l]);
+			wd->s[k * FFGE_WIDTH + l] = ffge_mod_red(s);
+			if (!wd->bm[l].done)
+				ffge_wied_bm_step(wd, l, k);
+		}
+		ffge_wied_barrier_wait(&wd->bar);
+
+		bool done = true;
+		for (size_t l = 0; l < FFGE_WIDTH; l++)
+			done &= wd->bm[l].done;
+		if (t == 0)
+			wd->steps = k;
+		if (done)
+			break;
+		int64_t *z = x;
+		x = w;
+		w = z;
+	}
+
+	return 0;
+}
+
+/* Split the rows of a CSR matrix into nt ranges of about the same number
+ * of non-zero elements.
+ */
+static void ffge_wied_split(const size_t *rp, size_t n, size_t nt,
+		size_t *split)
+{
+	size_t i = 0;
+
+	split[0] = 0;
+	for (size_t t = 1; t < nt; t++) {
+		const size_t nnz = rp[n] / nt * t;
+		while (i < n && rp[i] < nnz)
+			i++;
+		split[t] = i;
+	}
+	split[nt] = n;
+}
+
+/* Store P = D2 A D1 and Q = D1 A^T, with random diagonal D1 and D2. */
+static int ffge_wied_precond(struct ffge_wied *wd, const size_t *rp,
+		const size_t *ci, const int64_t *v, uint64_t *rng)
+{
+	const size_t nr = wd->nr, nc = wd->nc, nnz = rp[nr];
+	int64_t *d1 = malloc(nc * sizeof *d1), *d2 = malloc(nr * sizeof *d2);
+	int rt = -1;
+
+	/* one more element, so that malloc() is never asked for 0 bytes */
+	wd->p.rp = malloc((nr + 1) * sizeof *wd->p.rp);
+	wd->p.ci = malloc((nnz + 1) * sizeof *wd->p.ci);
+	wd->p.v = malloc((nnz + 1) * sizeof *wd->p.v);
+	wd->q.rp = calloc(nc + 2, sizeof *wd->q.rp);
+	wd->q.ci = malloc((nnz + 1) * sizeof *wd->q.ci);
+	wd->q.v = malloc((nnz + 1) * sizeof *wd->q.v);
+	if (!d1 || !d2 || !wd->p.rp || !wd->p.ci || !wd->p.v ||
+			!wd->q.rp || !wd->q.ci || !wd->q.v)
+		goto err;
+	for (size_t j = 0; j < nc; j++)
+		d1[j] = ffge_wied_rand(rng, true);
+	for (size_t i = 0; i < nr; i++)
+		d2[i] = ffge_wied_rand(rng, true);
+
+	size_t l = 0;
+	for (size_t i = 0; i < nr; i++) {
+		wd->p.rp[i] = l;
+		for (size_t k = rp[i]; k < rp[i + 1]; k++) {
+			int64_t a = v[k] % FFGE_PRIM;
+			if (a == 0)
+				continue;
+			a = a < 0 ? a + FFGE_PRIM : a;
+			wd->p.ci[l] = ci[k];
+			wd->p.v[l++] = ffge_mod_red(ffge_mod_red(
+				d2[i] * a) * d1[ci[k]]);
+			wd->q.rp[ci[k] + 2]++;
+		}
+	}
+	wd->p.rp[nr] = l;
+
+	/* transpose by counting sort */
+	for (size_t j = 2; j < nc + 2; j++)
+		wd->q.rp[j] += wd->q.rp[j - 1];
+	for (size_t i = 0; i < nr; i++) {
+		const int64_t d2_inv = ffge_mod_inv(d2[i]);
+		for (size_t k = wd->p.rp[i]; k < wd->p.rp[i + 1]; k++) {
+			const size_t j = wd->p.ci[k], e = wd->q.rp[j + 1]++;
+			wd->q.ci[e] = i;
+			wd->q.v[e] = ffge_mod_red(wd->p.v[k] * d2_inv);
+		}
+	}
+	rt = 0;
+err:
+	free(d1);
+	free(d2);
+
+	return rt;
+}
+
+static void ffge_wied_free(struct ffge_wied *wd)
+{
+	free(wd->p.rp);
+	free(wd->p.ci);
+	free(wd->p.v);
+	free(wd->q.rp);
+	free(wd->q.ci);
+	free(wd->q.v);
+	free(wd->p_split);
+	free(wd->q_split);
+	free(wd->x);
+	free(wd->y);
+	free(wd->w);
+	free(wd->u);
+	free(wd->s);
+	free(wd->dot);
+	for (size_t l = 0; l < FFGE_WIDTH; l++) {
+		free(wd->bm[l].c);
+		free(wd->bm[l].b);
+		free(wd->bm[l].t);
+	}
+}
+
+static int ffge_wied_init(struct ffge_wied *wd, const size_t *rp,
+		const size_t *ci, const int64_t *v, uint64_t seed)
+{
+	const size_t nr = wd->nr, nc = wd->nc, nt = wd->nt;
+	const size_t deg = (nr < nc ? nr : nc) + 1;
+
+	if (ffge_wied_precond(wd, rp, ci, v, &seed) < 0)
+		return -1;
+
+	wd->kmax = 2 * deg;
+	wd->p_split = malloc((nt + 1) * sizeof *wd->p_split);
+	wd->q_split = malloc((nt + 1) * sizeof *wd->q_split);
+	wd->x = malloc(nc * FFGE_WIDTH * sizeof *wd->x);
+	wd->y = malloc(nr * FFGE_WIDTH * sizeof *wd->y);
+	wd->w = malloc(nc * FFGE_WIDTH * sizeof *wd->w);
+	wd->u = malloc(nc * FFGE_WIDTH * sizeof *wd->u);
+	wd->s = malloc(wd->kmax * FFGE_WIDTH * sizeof *wd->s);
+	wd->dot = malloc(nt * FFGE_WIDTH * sizeof *wd->dot);
+	if (!wd->p_split || !wd->q_split || !wd->x || !wd->y || !wd->w ||
+			!wd->u || !wd->s || !wd->dot)
+		return -1;
+	for (size_t l = 0; l < FFGE_WIDTH; l++) {
+		struct ffge_wied_bm *bm = wd->bm + l;
+		bm->c = calloc(deg + 2, sizeof *bm->c);
+		bm->b = calloc(deg + 2, sizeof *bm->b);
+		bm->t = calloc(deg + 2, sizeof *bm->t);
+		if (!bm->c || !bm->b || !bm->t)
+			return -1;
+		bm->c[0] = bm->b[0] = 1;
+		bm->m = 1;
+		bm->db_inv = 1;
+	}
+
+	/* the 0-th term of the sequence, u^T x */
+	for (size_t i = 0; i < nc * FFGE_WIDTH; i++) {
+		wd->x[i] = ffge_wied_rand(&seed, false);
+		wd->u[i] = ffge_wied_rand(&seed, false);
+	}
+	ffge_wied_dot(wd->u, wd->x, 0, nc, wd->dot);
+	for (size_t l = 0; l < FFGE_WIDTH; l++) {
+		wd->s[l] = ffge_mod_red(wd->dot[l]);
+		ffge_wied_bm_step(wd, l, 0);
+	}
+
+	return 0;
+}
+
+size_t ffge_wiedemann_rank(const size_t *rp, const size_t *ci,
+		const int64_t *v, size_t nr, size_t nc, size_t threads,
+		uint64_t seed, struct ffge_wiedemann_stats *st)
+{
+	struct ffge_wied wd = { .nr = nr, .nc = nc };
+	struct ffge_wied_arg arg[FFGE_WIDTH];
+	thrd_t thr[FFGE_WIDTH];
+	size_t rank = SIZE_MAX, nt = 1;
+
+	if (nr == 0 || nc == 0) {
+		if (st)
+			*st = (struct ffge_wiedemann_stats){ 0 };
+		return 0;
+	}
+
+	/* at most one thread per lane, for the Berlekamp-Massey steps */
+	wd.nt = threads == 0 ? 1 : threads < FFGE_WIDTH ? threads : FFGE_WIDTH;
+	if (ffge_wied_init(&wd, rp, ci, v, seed) < 0)
+		goto out;
+	wd.bar.n = wd.nt;
+	if (mtx_init(&wd.bar.mtx, mtx_plain) != thrd_success)
+		goto out;
+	if (cnd_init(&wd.bar.cnd) != thrd_success) {
+		mtx_destroy(&wd.bar.mtx);
+		goto out;
+	}
+
+	/* If a thread cannot be created, run with the ones created so far.
+	 * The threads wait until their number is known.
+	 */
+	for (; nt < wd.nt; nt++) {
+		arg[nt] = (struct ffge_wied_arg){ .wd = &wd, .t = nt };
+		if (thrd_create(thr + nt, ffge_wied_run, arg + nt)
+				!= thrd_success)
+			break;
+	}
+	ffge_wied_split(wd.p.rp, nr, nt, wd.p_split);
+	ffge_wied_split(wd.q.rp, nc, nt, wd.q_split);
+	mtx_lock(&wd.bar.mtx);
+	wd.nt = wd.bar.n = nt;
+	wd.bar.go = true;
+	cnd_broadcast(&wd.bar.cnd);
+	mtx_unlock(&wd.bar.mtx);
+	arg[0] = (struct ffge_wied_arg){ .wd = &wd, .t = 0 };
+	ffge_wied_run(arg);
+	for (size_t t = 1; t < nt; t++)
+		thrd_join(thr[t], nullptr);
+	cnd_destroy(&wd.bar.cnd);
+	mtx_destroy(&wd.bar.mtx);
+
+	/* Each lane finds a divisor of the minimal polynomial f of B, and
+	 * with high probability the one of the highest degree is f itself.
+	 * Again with high probability, f = x g or f = g, with g(0) != 0 and
+	 * deg g the rank of B, equal to the rank of A.
+	 */
+	size_t lane = 0;
+	for (size_t l = 1; l < FFGE_WIDTH; l++)
+		if (wd.bm[l].l > wd.bm[lane].l)
+			lane = l;
+	const struct ffge_wied_bm *bm = wd.bm + lane;
+	rank = bm->l - (bm->c[bm->l] == 0);
+	if (st) {
+		st->steps = wd.steps + 1;
+		st->degree = bm->l;
+	}
+out:
+	ffge_wied_free(&wd);
+
+	return rank;
+}
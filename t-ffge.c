@@ -35,35 +35,36 @@ static struct xoshiro256ss RNG;
 static void test_ffge_unit(void)
 {
 	int64_t m0[1] = { 0 };
-	TEST_EQ(ffge(m0, 1), 0);
+	TEST_EQ(ffge(m0, 1, 1), 0);
 
 	int64_t m1[1] = { 1 };
-	TEST_EQ(ffge(m1, 1), 1);
+	TEST_EQ(ffge(m1, 1, 1), 1);
 }
 
 static void test_ffge_two(void)
 {
 	int64_t m0[4] = { 0, 0, 0, 0 };
-	TEST_EQ(ffge(m0, 2), 0);
+	TEST_EQ(ffge(m0, 2, 2), 0);
 
 	int64_t m1[4] = { 0, 1, 0, 0 };
-	TEST_EQ(ffge(m1, 2), 1);
+	TEST_EQ(ffge(m1, 2, 2), 1);
 
 	int64_t m2[4] = { 0, 1, 1, 0 };
-	TEST_EQ(ffge(m2, 2), 2);
+	TEST_EQ(ffge(m2, 2, 2), 2);
 }
 
 
-static void test_ffge_randrank(size_t n)
+static void test_ffge_randrank(size_t nr, size_t nc)
 {
-	size_t r;
+	size_t r, nm = nr < nc ? nr : nc;
 
 	for (size_t rep = 0; rep < REPS; rep++) {
-		for (size_t rank = 0; rank <= n; rank++) {
-			ffge_mat_genrand_prim(m, n, rank, 99, &RNG);
-			TEST_ASSERT((r = ffge(m, n)) == rank,
-				"rank=%zu, rank_exp=%zu, n=%zu, rep=%zu",
-					r, rank, n, rep);
+		for (size_t rank = 0; rank <= nm; rank++) {
+			ffge_mat_genrand_prim(m, nr, nc, rank, 99, &RNG);
+			TEST_ASSERT((r = ffge(m, nr, nc)) == rank,
+				"rank=%zu, rank_exp=%zu, nr=%zu, nc=%zu, "
+				"rep=%zu",
+					r, rank, nr, nc, rep);
 		}
 	}
 }
@@ -74,10 +75,15 @@ static void test_ffge(void)
 
 	test_ffge_two();
 
-	test_ffge_randrank(3);
-	test_ffge_randrank(5);
-	test_ffge_randrank(12);
-	test_ffge_randrank(25);
+	test_ffge_randrank(3, 3);
+	test_ffge_randrank(5, 5);
+	test_ffge_randrank(12, 12);
+	test_ffge_randrank(25, 25);
+
+	test_ffge_randrank(1, 4);
+	test_ffge_randrank(7, 3);
+	test_ffge_randrank(12, 17);
+	test_ffge_randrank(30, 25);
 }
 
 static void TEST_MAIN(void)
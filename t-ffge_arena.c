@@ -0,0 +1,99 @@
+/* -------------------------------------------------------------------------- *
+ * t-ffge_arena.c: Test the arena allocator.                                  *
+ *                                                                            *
+ * Copyright 2024 ⧉⧉⧉                                                         *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#include "test.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ffge.h"
+#include "utils.h"
+#include "xoshiro256ss.h"
+
+#define SEED UINT64_C(20481)
+static struct xoshiro256ss RNG;
+
+#define SIZE (12)
+static int64_t a[SIZE * SIZE];
+
+static void test_ffge_arena_alloc(void)
+{
+	struct ffge_arena *ar = ffge_arena_create(1, -1);
+	TEST_ASSERT(ar != nullptr, "cannot create arena");
+	if (!ar)
+		return;
+
+	unsigned char *p = ffge_arena_alloc(ar, 1);
+	unsigned char *q = ffge_arena_alloc(ar, 100);
+	unsigned char *r = ffge_arena_alloc(ar, 64);
+	TEST_EQ((uintptr_t)p % 64, 0);
+	TEST_EQ(q - p, 64);
+	TEST_EQ(r - q, 128);
+
+	/* the arena holds one page of 2 MiB */
+	TEST_ASSERT(ffge_arena_alloc(ar, (2 << 20) - 256) != nullptr,
+		"page not full");
+	TEST_ASSERT(ffge_arena_alloc(ar, 1) == nullptr, "page full");
+
+	ffge_arena_reset(ar);
+	TEST_ASSERT(ffge_arena_alloc(ar, 1) == p, "reset");
+	ffge_arena_destroy(ar);
+	ffge_arena_destroy(nullptr);
+}
+
+static void test_ffge_arena_i8(int node)
+{
+	struct ffge_arena *ar = ffge_arena_create(3 << 20, node);
+	TEST_ASSERT(ar != nullptr, "cannot create arena, node=%d", node);
+	if (!ar)
+		return;
+
+	for (size_t rep = 0; rep < 3; rep++) {
+		int64_t *m[99];
+		uint8_t fl_exp[99];
+
+		for (size_t b = 0; b < 99; b++) {
+			m[b] = ffge_arena_alloc_i8(ar, SIZE, SIZE);
+			TEST_EQ((uintptr_t)m[b] % 64, 0);
+			fl_exp[b] = 0;
+			for (size_t k = 0; k < FFGE_WIDTH; k++) {
+				size_t rnk = SIZE - k % 2;
+				ffge_mat_genrand_prim(a, SIZE, SIZE, rnk, 99,
+					&RNG);
+				for (size_t i = 0; i < SIZE*SIZE; i++)
+					m[b][i*FFGE_WIDTH + k] = a[i];
+				if (rnk == SIZE)
+					fl_exp[b] |= 1 << k;
+			}
+		}
+		for (size_t b = 0; b < 99; b++)
+			TEST_EQ(ffge_prim_i8(m[b], SIZE, SIZE), fl_exp[b]);
+
+		ffge_arena_reset(ar);
+	}
+	ffge_arena_destroy(ar);
+}
+
+static void TEST_MAIN(void)
+{
+	xoshiro256ss_init(&RNG, SEED);
+
+	test_ffge_arena_alloc();
+	test_ffge_arena_i8(-1);
+	test_ffge_arena_i8(0);
+}
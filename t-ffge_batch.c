@@ -0,0 +1,131 @@
+/* -------------------------------------------------------------------------- *
+ * t-ffge_batch.c: Test the binary container of batches of matrices.          *
+ *                                                                            *
+ * Copyright 2024 ⧉⧉⧉                                                         *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#include "test.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ffge.h"
+#include "utils.h"
+#include "xoshiro256ss.h"
+
+#define SEED UINT64_C(6401)
+static struct xoshiro256ss RNG;
+
+#define MAX_SIZE (9)
+#define COUNT (21)
+static int64_t a[MAX_SIZE * MAX_SIZE];
+static alignas(64) int64_t rows[COUNT * MAX_SIZE * MAX_SIZE];
+static alignas(64) int32_t rows32[COUNT * MAX_SIZE * MAX_SIZE];
+static alignas(64) int64_t packed[(COUNT + 7) / 8 * 8 * MAX_SIZE * MAX_SIZE];
+static alignas(64) int64_t w[MAX_SIZE * MAX_SIZE * FFGE_WIDTH];
+
+static struct ffge_batch header(size_t nr, size_t nc, size_t count,
+		uint32_t width, uint32_t layout)
+{
+	struct ffge_batch h = { .nr = nr, .nc = nc, .count = count,
+		.width = width, .layout = layout };
+	memcpy(h.magic, FFGE_BATCH_MAGIC, sizeof h.magic);
+
+	return h;
+}
+
+static void test_ffge_batch_size(void)
+{
+	struct ffge_batch h = header(3, 4, 9, 8, FFGE_BATCH_ROWS);
+	TEST_EQ(ffge_batch_size(&h), 3*4*9*8);
+	h.width = 4;
+	TEST_EQ(ffge_batch_size(&h), 3*4*9*4);
+	h.layout = FFGE_BATCH_PACKED;
+	TEST_EQ(ffge_batch_size(&h), 0);
+	h.width = 8;
+	TEST_EQ(ffge_batch_size(&h), 3*4*16*8);
+
+	h.layout = 2;
+	TEST_EQ(ffge_batch_size(&h), 0);
+	h.layout = FFGE_BATCH_ROWS;
+	h.width = 2;
+	TEST_EQ(ffge_batch_size(&h), 0);
+	h.width = 8;
+	h.reserved[1] = 1;
+	TEST_EQ(ffge_batch_size(&h), 0);
+	h.reserved[1] = 0;
+	h.magic[7] = '2';
+	TEST_EQ(ffge_batch_size(&h), 0);
+	h.magic[7] = '1';
+	h.count = 0;
+	TEST_EQ(ffge_batch_size(&h), 0);
+	h.count = UINT64_MAX / 8;
+	TEST_EQ(ffge_batch_size(&h), 0);
+}
+
+static void test_ffge_batch_group(size_t nr, size_t nc)
+{
+	const size_t ne = nr * nc, nm = nr < nc ? nr : nc;
+	uint8_t fl_exp[(COUNT + 7) / 8] = { 0 };
+
+	for (size_t l = 0; l < COUNT; l++) {
+		size_t rnk = xoshiro256ss_next(&RNG) % 2 ? nm : l % nm;
+		ffge_mat_genrand_prim(a, nr, nc, rnk, 99, &RNG);
+		for (size_t e = 0; e < ne; e++) {
+			rows[l*ne + e] = rows32[l*ne + e] = a[e];
+			packed[((l/8)*ne + e)*FFGE_WIDTH + l%8] = a[e];
+		}
+		if (rnk == nm)
+			fl_exp[l/8] |= 1 << l%8;
+	}
+
+	struct ffge_batch h = header(nr, nc, COUNT, 8, FFGE_BATCH_ROWS);
+	struct ffge_batch h32 = header(nr, nc, COUNT, 4, FFGE_BATCH_ROWS);
+	struct ffge_batch hp = header(nr, nc, COUNT, 8, FFGE_BATCH_PACKED);
+
+	for (size_t g = 0; g < (COUNT + 7) / 8; g++) {
+		TEST_EQ(ffge_batch_group(&hp, packed, g, w),
+			packed + g*ne*FFGE_WIDTH);
+
+		TEST_EQ(ffge_batch_group(&h32, rows32, g, w), w);
+		bool same = true;
+		for (size_t i = 0; i < ne*FFGE_WIDTH; i++)
+			same &= g*8 + i%8 >= COUNT ?
+				w[i] == (i/8 / nc == i/8 % nc) :
+				w[i] == packed[g*ne*FFGE_WIDTH + i];
+		TEST_ASSERT(same, "nr=%zu, nc=%zu, g=%zu", nr, nc, g);
+
+		TEST_EQ(ffge_batch_group(&h, rows, g, w), w);
+		const uint8_t fl = ffge_prim_i8(w, nr, nc);
+		const uint8_t mask = COUNT - g*8 < 8 ?
+			(1 << (COUNT - g*8)) - 1 : 0xff;
+		TEST_ASSERT((fl & mask) == fl_exp[g],
+			"fl=%x, fl_exp=%x, nr=%zu, nc=%zu, g=%zu",
+				fl, fl_exp[g], nr, nc, g);
+	}
+}
+
+static void TEST_MAIN(void)
+{
+	xoshiro256ss_init(&RNG, SEED);
+
+	test_ffge_batch_size();
+
+	test_ffge_batch_group(1, 1);
+	test_ffge_batch_group(5, 5);
+	test_ffge_batch_group(9, 9);
+	test_ffge_batch_group(3, 7);
+}
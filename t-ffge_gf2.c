@@ -0,0 +1,180 @@
+/* -------------------------------------------------------------------------- *
+ * t-ffge_gf2.c: Test the implementation of ffge_gf2.                         *
+ *                                                                            *
+ * Copyright 2024 ⧉⧉⧉                                                         *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#include "test.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ffge.h"
+#include "xoshiro256ss.h"
+
+#define REPS (9L)
+
+#define SEED UINT64_C(42173)
+static struct xoshiro256ss RNG;
+
+#define MAX_ROWS (700)
+#define MAX_STRIDE (16)
+static alignas(64) uint64_t m[MAX_ROWS * MAX_STRIDE];
+static uint64_t a[MAX_ROWS * MAX_STRIDE], b[MAX_ROWS * MAX_STRIDE];
+static alignas(64) uint64_t m_i8[MAX_ROWS * FFGE_WIDTH];
+
+/* Generate a random matrix of nr rows and nc columns, and rank at most rnk,
+ * as a product of random matrices of sizes nr x rnk and rnk x nc.
+ */
+static void genrand_gf2(uint64_t *m, size_t nr, size_t nc, size_t rnk)
+{
+	const size_t st = FFGE_GF2_STRIDE(nc);
+
+	for (size_t i = 0; i < rnk; i++)
+		for (size_t j = 0; j < st; j++)
+			b[i*st + j] = j*64 < nc ? xoshiro256ss_next(&RNG) : 0;
+	for (size_t i = 0; i < rnk; i++)
+		if (nc % 64)
+			b[i*st + nc/64] &= (UINT64_C(1) << nc % 64) - 1;
+
+	for (size_t i = 0; i < nr; i++) {
+		for (size_t j = 0; j < st; j++)
+			m[i*st + j] = 0;
+		for (size_t k = 0; k < rnk; k++)
+			if (xoshiro256ss_next(&RNG) % 2)
+				for (size_t j = 0; j < st; j++)
+					m[i*st + j] ^= b[k*st + j];
+	}
+}
+
+/* Compute the rank of m by a naive elimination, one bit at a time. */
+static size_t rank_gf2(uint64_t *m, size_t nr, size_t nc)
+{
+	const size_t st = FFGE_GF2_STRIDE(nc);
+	size_t pr = 0;
+
+	for (size_t pc = 0; pc < nc && pr < nr; pc++) {
+		size_t i = pr;
+		while (i < nr && !((m[i*st + pc/64] >> pc%64) & 1))
+			i++;
+		if (i == nr)
+			continue;
+		for (size_t j = 0; j < st; j++) {
+			uint64_t zz = m[i*st + j];
+			m[i*st + j] = m[pr*st + j];
+			m[pr*st + j] = zz;
+		}
+		for (i = pr + 1; i < nr; i++)
+			if ((m[i*st + pc/64] >> pc%64) & 1)
+				for (size_t j = 0; j < st; j++)
+					m[i*st + j] ^= m[pr*st + j];
+		pr++;
+	}
+
+	return pr;
+}
+
+static void test_ffge_gf2_two(void)
+{
+	m[0*8] = 0b00;
+	m[1*8] = 0b00;
+	TEST_EQ(ffge_gf2(m, 2, 2), 0);
+
+	m[0*8] = 0b10;
+	m[1*8] = 0b00;
+	TEST_EQ(ffge_gf2(m, 2, 2), 1);
+
+	m[0*8] = 0b10;
+	m[1*8] = 0b01;
+	TEST_EQ(ffge_gf2(m, 2, 2), 2);
+
+	m[0*8] = 0b11;
+	m[1*8] = 0b11;
+	TEST_EQ(ffge_gf2(m, 2, 2), 1);
+}
+
+static void test_ffge_gf2_randrank(size_t nr, size_t nc)
+{
+	const size_t nm = nr < nc ? nr : nc;
+	const size_t st = FFGE_GF2_STRIDE(nc);
+	size_t r, r_exp;
+
+	for (size_t rep = 0; rep < REPS; rep++) {
+		const size_t rnk = rep % 3 == 0 ?
+			nm : xoshiro256ss_next(&RNG) % (nm + 1);
+		genrand_gf2(m, nr, nc, rnk);
+		for (size_t i = 0; i < nr*st; i++)
+			a[i] = m[i];
+
+		r_exp = rank_gf2(a, nr, nc);
+		TEST_ASSERT((r = ffge_gf2(m, nr, nc)) == r_exp,
+			"rank=%zu, rank_exp=%zu, nr=%zu, nc=%zu, rep=%zu",
+				r, r_exp, nr, nc, rep);
+	}
+}
+
+static void test_ffge_gf2_i8(size_t nr, size_t nc)
+{
+	const size_t nm = nr < nc ? nr : nc;
+
+	for (size_t rep = 0; rep < REPS * 11; rep++) {
+		uint8_t fl, fl_exp = 0;
+
+		for (size_t k = 0; k < FFGE_WIDTH; k++) {
+			const size_t rnk = xoshiro256ss_next(&RNG) % 2 ?
+				nm : xoshiro256ss_next(&RNG) % (nm + 1);
+			genrand_gf2(a, nr, nc, rnk);
+			for (size_t i = 0; i < nr; i++)
+				m_i8[i*FFGE_WIDTH + k] = a[i*8];
+			if (rank_gf2(a, nr, nc) == nm)
+				fl_exp |= 1 << k;
+		}
+
+		TEST_ASSERT((fl = ffge_gf2_i8(m_i8, nr, nc)) == fl_exp,
+			"fl=%x, fl_exp=%x, nr=%zu, nc=%zu, rep=%zu",
+				fl, fl_exp, nr, nc, rep);
+	}
+}
+
+static void test_ffge_gf2(void)
+{
+	test_ffge_gf2_two();
+
+	test_ffge_gf2_randrank(1, 1);
+	test_ffge_gf2_randrank(5, 7);
+	test_ffge_gf2_randrank(64, 64);
+	test_ffge_gf2_randrank(100, 70);
+	test_ffge_gf2_randrank(130, 600);
+
+	/* Method of Four Russians */
+	test_ffge_gf2_randrank(256, 256);
+	test_ffge_gf2_randrank(300, 300);
+	test_ffge_gf2_randrank(513, 600);
+	test_ffge_gf2_randrank(700, 300);
+
+	test_ffge_gf2_i8(1, 1);
+	test_ffge_gf2_i8(3, 3);
+	test_ffge_gf2_i8(12, 12);
+	test_ffge_gf2_i8(40, 20);
+	test_ffge_gf2_i8(20, 64);
+	test_ffge_gf2_i8(64, 64);
+}
+
+static void TEST_MAIN(void)
+{
+	xoshiro256ss_init(&RNG, SEED);
+
+	test_ffge_gf2();
+}
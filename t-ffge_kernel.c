@@ -0,0 +1,159 @@
+/* -------------------------------------------------------------------------- *
+ * t-ffge_kernel.c: Test the implementation of ffge_prim_kernel.              *
+ *                                                                            *
+ * Copyright 2024 ⧉⧉⧉                                                         *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#include "test.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ffge.h"
+#include "utils.h"
+#include "xoshiro256ss.h"
+
+#define REPS (33L)
+
+#define SEED UINT64_C(5521)
+static struct xoshiro256ss RNG;
+
+#define MAX_SIZE (24)
+static int64_t m[MAX_SIZE * MAX_SIZE], a[MAX_SIZE * MAX_SIZE];
+static int64_t k[MAX_SIZE * MAX_SIZE];
+static alignas(64) int64_t m_i8[MAX_SIZE * MAX_SIZE * FFGE_WIDTH];
+static alignas(64) int64_t a_i8[MAX_SIZE * MAX_SIZE * FFGE_WIDTH];
+static alignas(64) int64_t k_i8[MAX_SIZE * MAX_SIZE * FFGE_WIDTH];
+
+/* Check if a v = 0 over Z_p, and v != 0.  The elements of the matrix a
+ * of nr rows and nc columns and of the vector v are at stride st.
+ */
+static bool is_kernel(const int64_t *a, size_t nr, size_t nc,
+			const int64_t *v, size_t st)
+{
+	bool nz = false;
+	for (size_t j = 0; j < nc; j++)
+		nz |= v[j*st] % FFGE_PRIM != 0;
+	if (!nz)
+		return false;
+
+	for (size_t i = 0; i < nr; i++) {
+		int64_t s = 0;
+		for (size_t j = 0; j < nc; j++)
+			s = (s + a[(i*nc + j)*st] * v[j*st]) % FFGE_PRIM;
+		if (s != 0)
+			return false;
+	}
+
+	return true;
+}
+
+static void test_ffge_prim_kernel_two(void)
+{
+	int64_t m0[4] = { 0, 0, 0, 0 };
+	TEST_EQ(ffge_prim_kernel(m0, 2, 2, k), 2);
+	TEST_EQ(k[0*2 + 0], 1);
+	TEST_EQ(k[0*2 + 1], 0);
+	TEST_EQ(k[1*2 + 0], 0);
+	TEST_EQ(k[1*2 + 1], 1);
+
+	int64_t m1[4] = { 2, 4, 1, 2 };
+	TEST_EQ(ffge_prim_kernel(m1, 2, 2, k), 1);
+	TEST_EQ(k[0], -2);
+	TEST_EQ(k[1], 1);
+
+	int64_t m2[4] = { 0, 1, 1, 0 };
+	TEST_EQ(ffge_prim_kernel(m2, 2, 2, k), 0);
+}
+
+static void test_ffge_prim_kernel_randrank(size_t nr, size_t nc)
+{
+	const size_t nm = nr < nc ? nr : nc;
+	size_t d;
+
+	for (size_t rep = 0; rep < REPS; rep++)
+		for (size_t rank = 0; rank <= nm; rank++) {
+			ffge_mat_genrand_prim(a, nr, nc, rank, 99, &RNG);
+			for (size_t i = 0; i < nr*nc; i++)
+				m[i] = a[i];
+
+			TEST_ASSERT((d = ffge_prim_kernel(m, nr, nc, k))
+					== nc - rank,
+				"d=%zu, rank=%zu, nr=%zu, nc=%zu, rep=%zu",
+					d, rank, nr, nc, rep);
+			for (size_t i = 0; i < d; i++)
+				TEST_ASSERT(is_kernel(a, nr, nc, k + i*nc, 1),
+					"i=%zu, rank=%zu, nr=%zu, nc=%zu",
+						i, rank, nr, nc);
+		}
+}
+
+static void test_ffge_prim_kernel_i8(size_t nr, size_t nc)
+{
+ const size_t nm = nr < nc ? nr : nc;
+ for (size_t rep = 0; rep < REPS; rep++) {
+
+	uint8_t fl, fl_exp = 0;
+	size_t rnk[FFGE_WIDTH], dim[FFGE_WIDTH];
+
+	for (size_t l = 0; l < FFGE_WIDTH; l++) {
+		rnk[l] = xoshiro256ss_next(&RNG) % (nm + 1);
+		if (rnk[l] == nm)
+			fl_exp |= (1 << l);
+		ffge_mat_genrand_prim(a, nr, nc, rnk[l], 99, &RNG);
+		for (size_t i = 0; i < nr*nc; i++)
+			a_i8[i*FFGE_WIDTH + l] = a[i];
+	}
+	for (size_t i = 0; i < nr*nc*FFGE_WIDTH; i++)
+		m_i8[i] = a_i8[i];
+
+	TEST_ASSERT((fl = ffge_prim_kernel_i8(m_i8, nr, nc, k_i8, dim))
+			== fl_exp,
+			"fl=%x, fl_exp=%x, nr=%zu, nc=%zu, rep=%zu",
+				fl, fl_exp, nr, nc, rep);
+
+	for (size_t l = 0; l < FFGE_WIDTH; l++) {
+		TEST_EQ(dim[l], nc - rnk[l]);
+		for (size_t i = 0; i < dim[l]; i++)
+			TEST_ASSERT(is_kernel(a_i8 + l, nr, nc,
+					k_i8 + i*nc*FFGE_WIDTH + l, FFGE_WIDTH),
+				"i=%zu, l=%zu, nr=%zu, nc=%zu, rep=%zu",
+					i, l, nr, nc, rep);
+	}
+ }
+}
+
+static void test_ffge_prim_kernel(void)
+{
+	test_ffge_prim_kernel_two();
+
+	test_ffge_prim_kernel_randrank(3, 3);
+	test_ffge_prim_kernel_randrank(12, 12);
+	test_ffge_prim_kernel_randrank(4, 9);
+	test_ffge_prim_kernel_randrank(20, 7);
+
+	test_ffge_prim_kernel_i8(1, 1);
+	test_ffge_prim_kernel_i8(6, 6);
+	test_ffge_prim_kernel_i8(17, 17);
+	test_ffge_prim_kernel_i8(5, 11);
+	test_ffge_prim_kernel_i8(24, 13);
+}
+
+static void TEST_MAIN(void)
+{
+	xoshiro256ss_init(&RNG, SEED);
+
+	test_ffge_prim_kernel();
+}
@@ -0,0 +1,176 @@
+/* -------------------------------------------------------------------------- *
+ * t-ffge_lu.c: Test the implementation of ffge_prim_lu.                      *
+ *                                                                            *
+ * Copyright 2024 ⧉⧉⧉                                                         *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#include "test.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ffge.h"
+#include "utils.h"
+#include "xoshiro256ss.h"
+
+#define REPS (99L)
+
+#define SEED UINT64_C(77123)
+static struct xoshiro256ss RNG;
+
+#define MAX_SIZE (28)
+static int64_t m[MAX_SIZE * MAX_SIZE], a[MAX_SIZE * MAX_SIZE];
+static size_t p[MAX_SIZE * FFGE_WIDTH];
+static int64_t x[MAX_SIZE * FFGE_WIDTH], b[MAX_SIZE * FFGE_WIDTH];
+static alignas(64) int64_t m_i8[MAX_SIZE * MAX_SIZE * FFGE_WIDTH];
+static alignas(64) int64_t a_i8[MAX_SIZE * MAX_SIZE * FFGE_WIDTH];
+
+/* Compute b = a x over Z_p. */
+static void matvec(const int64_t *a, const int64_t *x, int64_t *b, size_t n)
+{
+	for (size_t i = 0; i < n; i++) {
+		b[i] = 0;
+		for (size_t j = 0; j < n; j++)
+			b[i] = (b[i] + a[i*n + j] * x[j]) % FFGE_PRIM;
+	}
+}
+
+static void test_ffge_prim_lu_two(void)
+{
+	int64_t m0[4] = { 0, 0, 0, 0 };
+	TEST_EQ(ffge_prim_lu(m0, p, 2), 0);
+	TEST_EQ(ffge_prim_lu_solve(m0, p, 2, b), -1);
+
+	int64_t m1[4] = { 0, 2, 3, 1 };
+	TEST_EQ(ffge_prim_lu(m1, p, 2), 2);
+	TEST_EQ(p[0], 1);
+	TEST_EQ(m1[0*2 + 0], 3);
+	TEST_EQ(m1[0*2 + 1], 1);
+	TEST_EQ(m1[1*2 + 0], 0);
+	TEST_EQ(m1[1*2 + 1], 2);
+
+	/* 2 x_1 = 4, 3 x_0 + x_1 = 5 */
+	int64_t b1[2] = { 4, 5 };
+	TEST_EQ(ffge_prim_lu_solve(m1, p, 2, b1), 0);
+	TEST_EQ(b1[0], 1);
+	TEST_EQ(b1[1], 2);
+}
+
+static void test_ffge_prim_lu_randrank(size_t n)
+{
+	size_t r;
+
+	for (size_t rep = 0; rep < REPS; rep++)
+		for (size_t rank = 0; rank <= n; rank++) {
+			ffge_mat_genrand_prim(m, n, n, rank, 99, &RNG);
+			TEST_ASSERT((r = ffge_prim_lu(m, p, n)) == rank,
+				"rank=%zu, rank_exp=%zu, n=%zu, rep=%zu",
+					r, rank, n, rep);
+		}
+}
+
+static void test_ffge_prim_lu_solve(size_t n)
+{
+	for (size_t rep = 0; rep < REPS; rep++) {
+		ffge_mat_genrand_prim(a, n, n, n, 99, &RNG);
+		for (size_t i = 0; i < n*n; i++)
+			m[i] = a[i];
+		ffge_prim_lu(m, p, n);
+
+		/* solve for a few right-hand sides with one factorization */
+		for (size_t s = 0; s < 3; s++) {
+			for (size_t i = 0; i < n; i++)
+				x[i] = xoshiro256ss_next(&RNG) % FFGE_PRIM;
+			matvec(a, x, b, n);
+
+			TEST_EQ(ffge_prim_lu_solve(m, p, n, b), 0);
+			for (size_t i = 0; i < n; i++)
+				TEST_ASSERT((b[i] - x[i]) % FFGE_PRIM == 0,
+					"i=%zu, n=%zu, rep=%zu", i, n, rep);
+		}
+	}
+}
+
+static void test_ffge_prim_lu_i8(size_t n)
+{
+ for (size_t rep = 0; rep < REPS; rep++) {
+
+	uint8_t fl, fl_exp = 0;
+
+	/* generate random matrix, and right-hand side; pack them */
+	for (size_t k = 0; k < FFGE_WIDTH; k++) {
+		size_t rnk = (xoshiro256ss_next(&RNG) % 2) == 1 ?
+			n : xoshiro256ss_next(&RNG) % n;
+		if (rnk == n)
+			fl_exp |= (1 << k);
+		ffge_mat_genrand_prim(a, n, n, rnk, 99, &RNG);
+		for (size_t i = 0; i < n; i++)
+			for (size_t j = 0; j < n; j++)
+				a_i8[(i*n + j)*FFGE_WIDTH + k] = a[i*n + j];
+
+		int64_t xk[MAX_SIZE], bk[MAX_SIZE];
+		for (size_t i = 0; i < n; i++)
+			xk[i] = xoshiro256ss_next(&RNG) % FFGE_PRIM;
+		matvec(a, xk, bk, n);
+		for (size_t i = 0; i < n; i++) {
+			x[i*FFGE_WIDTH + k] = xk[i];
+			b[i*FFGE_WIDTH + k] = bk[i];
+		}
+	}
+	for (size_t i = 0; i < n*n*FFGE_WIDTH; i++)
+		m_i8[i] = a_i8[i];
+
+	TEST_ASSERT((fl = ffge_prim_lu_i8(m_i8, p, n)) == fl_exp,
+			"fl=%x, fl_exp=%x, n=%zu, rep=%zu",
+				fl, fl_exp, n, rep);
+
+	ffge_prim_lu_solve_i8(m_i8, p, n, b);
+	for (size_t k = 0; k < FFGE_WIDTH; k++) {
+		if (!((fl_exp >> k) & 1))
+			continue;
+		for (size_t i = 0; i < n; i++)
+			TEST_ASSERT((b[i*FFGE_WIDTH + k] -
+				x[i*FFGE_WIDTH + k]) % FFGE_PRIM == 0,
+				"i=%zu, k=%zu, n=%zu, rep=%zu", i, k, n, rep);
+	}
+ }
+}
+
+static void test_ffge_prim_lu(void)
+{
+	test_ffge_prim_lu_two();
+
+	test_ffge_prim_lu_randrank(3);
+	test_ffge_prim_lu_randrank(5);
+	test_ffge_prim_lu_randrank(12);
+	test_ffge_prim_lu_randrank(25);
+
+	test_ffge_prim_lu_solve(1);
+	test_ffge_prim_lu_solve(4);
+	test_ffge_prim_lu_solve(13);
+	test_ffge_prim_lu_solve(28);
+
+	test_ffge_prim_lu_i8(3);
+	test_ffge_prim_lu_i8(6);
+	test_ffge_prim_lu_i8(12);
+	test_ffge_prim_lu_i8(23);
+}
+
+static void TEST_MAIN(void)
+{
+	xoshiro256ss_init(&RNG, SEED);
+
+	test_ffge_prim_lu();
+}
@@ -0,0 +1,128 @@
+/* -------------------------------------------------------------------------- *
+ * t-ffge_pipe.c: Test the implementation of ffge_pipe_run                    *
+ *                                                                            *
+ * Copyright 2024 Marek Miller & ⧉⧉⧉                                          *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#include "test.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ffge.h"
+#include "utils.h"
+#include "xoshiro256ss.h"
+
+#define SEED UINT64_C(41911)
+static struct xoshiro256ss RNG;
+
+#define MAX_SIZE (12)
+#define COUNT (2053)
+
+static int64_t a[MAX_SIZE * MAX_SIZE];
+static bool full_exp[COUNT];
+
+/* State shared by the producer and the consumer.  Each field is written
+ * by one of them only.
+ */
+struct pipe_test {
+	size_t nr, nc, count;
+	size_t gen;		/* matrices generated */
+	size_t next;		/* next matrix expected by the consumer */
+	size_t errors;
+};
+
+static bool gen(int64_t *m, void **tag, void *data)
+{
+	struct pipe_test *pt = data;
+	const size_t nr = pt->nr, nc = pt->nc, nm = nr < nc ? nr : nc;
+
+	if (pt->gen == pt->count)
+		return false;
+
+	size_t rnk = (xoshiro256ss_next(&RNG) % 2) == 1 ?
+		nm : xoshiro256ss_next(&RNG) % nm;
+	ffge_mat_genrand_prim(m, nr, nc, rnk, 99, &RNG);
+	memcpy(a, m, nr * nc * sizeof *a);
+	full_exp[pt->gen] = ffge_prim(a, nr, nc) == nm;
+	*tag = full_exp + pt->gen++;
+
+	return true;
+}
+
+static void collect(void *tag, bool full_rank, void *data)
+{
+	struct pipe_test *pt = data;
+	const bool *exp = tag;
+
+	/* in order, with the right result */
+	if (exp != full_exp + pt->next++ || *exp != full_rank)
+		pt->errors++;
+}
+
+static void test_ffge_pipe_run(size_t nr, size_t nc, size_t count,
+		size_t groups, const int *cpu)
+{
+	struct pipe_test pt = { .nr = nr, .nc = nc, .count = count };
+	struct ffge_pipe_stats st;
+
+	TEST_EQ(ffge_pipe_run(nr, nc, groups, cpu, gen, collect, &pt, &st),
+		0);
+	TEST_ASSERT(pt.errors == 0 && pt.next == count,
+		"errors=%zu, collected=%zu, nr=%zu, nc=%zu, count=%zu, "
+		"groups=%zu", pt.errors, pt.next, nr, nc, count, groups);
+
+	/* the groups that carry matrices, and the last one */
+	const size_t ng = count / FFGE_WIDTH + 1;
+	TEST_EQ(st.matrices, count);
+	for (size_t s = 0; s < FFGE_PIPE_STAGES; s++) {
+		TEST_EQ(st.stage[s].groups, ng);
+		TEST_ASSERT(st.stage[s].busy_ns <= st.ns &&
+			st.stage[s].depth <= ng * groups,
+			"stage=%zu, busy_ns=%zu, ns=%zu, depth=%zu", s,
+			(size_t)st.stage[s].busy_ns, (size_t)st.ns,
+			(size_t)st.stage[s].depth);
+	}
+}
+
+static void test_ffge_pipe_errors(void)
+{
+	struct pipe_test pt = { .nr = 2, .nc = 2, .count = 5 };
+	const int cpu[FFGE_PIPE_STAGES] = { 0, 0, 1 << 30, 0 };
+
+	TEST_EQ(ffge_pipe_run(2, 2, 0, nullptr, gen, collect, &pt, nullptr),
+		-1);
+	TEST_EQ(ffge_pipe_run(2, 2, 4, cpu, gen, collect, &pt, nullptr), -1);
+	TEST_EQ(pt.gen, 0);
+	TEST_EQ(pt.next, 0);
+}
+
+static void TEST_MAIN(void)
+{
+	xoshiro256ss_init(&RNG, SEED);
+
+	test_ffge_pipe_errors();
+
+	const int cpu[FFGE_PIPE_STAGES] = { 0, -1, 0, -1 };
+	const size_t counts[] = { 0, 1, 7, 8, 9, 100, COUNT };
+	for (size_t i = 0; i < sizeof counts / sizeof *counts; i++) {
+		test_ffge_pipe_run(4, 4, counts[i], 1, nullptr);
+		test_ffge_pipe_run(5, 5, counts[i], 3, cpu);
+		test_ffge_pipe_run(MAX_SIZE, MAX_SIZE, counts[i], 8, nullptr);
+		test_ffge_pipe_run(3, 7, counts[i], 8, nullptr);
+		test_ffge_pipe_run(9, 4, counts[i], 2, nullptr);
+	}
+}
@@ -0,0 +1,142 @@
+/* -------------------------------------------------------------------------- *
+ * t-ffge_prim16_i32.c: Test the implementation of ffge_prim16_i32            *
+ *                                                                            *
+ * Copyright 2024 ⧉⧉⧉                                                         *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#include "test.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ffge.h"
+#include "utils.h"
+#include "xoshiro256ss.h"
+
+#define REPS (199L)
+
+#define SEED UINT64_C(32749)
+static struct xoshiro256ss RNG;
+
+#define MAX_SIZE (28)
+static int64_t m[MAX_SIZE * MAX_SIZE];
+static alignas(64) uint16_t m_i32[MAX_SIZE * MAX_SIZE * FFGE_WIDTH16];
+
+/* Compute the rank of m modulo FFGE_PRIM16 by Gaussian elimination.  The
+ * elements of m are in the range 0, 1, ..., FFGE_PRIM16-1.
+ */
+static size_t rank_prim16(int64_t *m, size_t nr, size_t nc)
+{
+	size_t pc, pr = 0;
+	for (pc = 0; pc < nc && pr < nr; pc++) {
+		size_t i = pr;
+		while (i < nr && m[i*nc + pc] == 0)
+			i++;
+		if (i == nr)
+			continue;
+		for (size_t j = 0; j < nc; j++) {
+			int64_t zz = m[i*nc + j];
+			m[i*nc + j] = m[pr*nc + j];
+			m[pr*nc + j] = zz;
+		}
+		for (i = pr + 1; i < nr; i++) {
+			const int64_t m_ic = m[i*nc + pc];
+			for (size_t j = pc; j < nc; j++)
+				m[i*nc + j] = (m[i*nc + j] * m[pr*nc + pc] -
+					m[pr*nc + j] * m_ic) % FFGE_PRIM16;
+			for (size_t j = pc; j < nc; j++)
+				if (m[i*nc + j] < 0)
+					m[i*nc + j] += FFGE_PRIM16;
+		}
+		pr++;
+	}
+
+	return pr;
+}
+
+static void test_ffge_prim16_i32_unit(void)
+{
+	for (size_t k = 0; k < FFGE_WIDTH16; k++)
+		m_i32[k] = k + 1;
+	TEST_EQ(ffge_prim16_i32(m_i32, 1, 1), 0xffffffff);
+
+	m_i32[3] = 0;
+	TEST_EQ(ffge_prim16_i32(m_i32, 1, 1), 0xfffffff7);
+
+	m_i32[30] = 0;
+	TEST_EQ(ffge_prim16_i32(m_i32, 1, 1), 0xbffffff7);
+}
+
+static void test_ffge_prim16_i32_two(void)
+{
+	/* the determinant is a multiple of FFGE_PRIM16 for k = 5 only */
+	for (size_t k = 0; k < FFGE_WIDTH16; k++) {
+		m_i32[(0*2 + 0)*FFGE_WIDTH16 + k] = FFGE_PRIM16 - 1;
+		m_i32[(0*2 + 1)*FFGE_WIDTH16 + k] = 2;
+		m_i32[(1*2 + 0)*FFGE_WIDTH16 + k] = k;
+		m_i32[(1*2 + 1)*FFGE_WIDTH16 + k] = FFGE_PRIM16 - 10;
+	}
+
+	TEST_EQ(ffge_prim16_i32(m_i32, 2, 2), ~(UINT32_C(1) << 5));
+}
+
+static void test_ffge_prim16_i32_randrank(size_t nr, size_t nc)
+{
+ const size_t nm = nr < nc ? nr : nc;
+ for (size_t rep = 0; rep < REPS; rep++) {
+
+	uint32_t fl, fl_exp = 0;
+
+	/* generate random matrix; set ref. flags, pack it */
+	for (size_t k = 0; k < FFGE_WIDTH16; k++) {
+		size_t rnk = (xoshiro256ss_next(&RNG) % 2) == 1 ?
+			nm : xoshiro256ss_next(&RNG) % nm;
+		ffge_mat_genrand_prim(m, nr, nc, rnk, 99, &RNG);
+		for (size_t i = 0; i < nr*nc; i++) {
+			m[i] %= FFGE_PRIM16;
+			if (m[i] < 0)
+				m[i] += FFGE_PRIM16;
+			m_i32[i*FFGE_WIDTH16 + k] = m[i];
+		}
+		if (rank_prim16(m, nr, nc) == nm)
+			fl_exp |= UINT32_C(1) << k;
+	}
+
+	TEST_ASSERT((fl = ffge_prim16_i32(m_i32, nr, nc)) == fl_exp,
+			"fl=%x, fl_exp=%x, nr=%zu, nc=%zu, rep=%zu",
+				fl, fl_exp, nr, nc, rep);
+ }
+}
+
+static void test_ffge_prim16_i32(void)
+{
+	test_ffge_prim16_i32_unit();
+	test_ffge_prim16_i32_two();
+
+	test_ffge_prim16_i32_randrank(3, 3);
+	test_ffge_prim16_i32_randrank(6, 6);
+	test_ffge_prim16_i32_randrank(12, 12);
+	test_ffge_prim16_i32_randrank(23, 23);
+
+	test_ffge_prim16_i32_randrank(2, 7);
+	test_ffge_prim16_i32_randrank(19, 8);
+}
+
+static void TEST_MAIN(void)
+{
+	xoshiro256ss_init(&RNG, SEED);
+
+	test_ffge_prim16_i32();
+}
@@ -20,6 +20,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "ffge.h"
 #include "utils.h"
@@ -33,18 +34,34 @@ static struct xoshiro256ss RNG;
 #define MAX_SIZE (28)
 static int64_t m[MAX_SIZE * MAX_SIZE];
 static alignas(64) int64_t m_i8[MAX_SIZE * MAX_SIZE * FFGE_WIDTH];
+static alignas(64) int64_t m_cp[MAX_SIZE * MAX_SIZE * FFGE_WIDTH];
+static alignas(64) int64_t w[MAX_SIZE * MAX_SIZE * FFGE_WIDTH];
+
+/* Call ffge_prim_rank_i8() on m_i8, and check that m_i8 is left intact. */
+static uint8_t rank_i8(size_t nr, size_t nc)
+{
+	const size_t sz = nr * nc * FFGE_WIDTH * sizeof *m_i8;
+
+	memcpy(m_cp, m_i8, sz);
+	const uint8_t fl = ffge_prim_rank_i8(m_i8, nr, nc, w);
+	TEST_ASSERT(memcmp(m_cp, m_i8, sz) == 0, "nr=%zu, nc=%zu", nr, nc);
+
+	return fl;
+}
 
 static void test_ffge_prim_i8_unit(void)
 {
 	for (size_t k = 0; k < FFGE_WIDTH; k++)
 		m_i8[k] = 1;
-	TEST_EQ(ffge_prim_i8(m_i8, 1), 0xff);
+	TEST_EQ(rank_i8(1, 1), 0xff);
+	TEST_EQ(ffge_prim_i8(m_i8, 1, 1), 0xff);
 
 	m_i8[3] = 0;
-	TEST_EQ(ffge_prim_i8(m_i8, 1), 0b11110111);
+	TEST_EQ(rank_i8(1, 1), 0b11110111);
+	TEST_EQ(ffge_prim_i8(m_i8, 1, 1), 0b11110111);
 
 	m_i8[6] = 0;
-	TEST_EQ(ffge_prim_i8(m_i8, 1), 0b10110111);
+	TEST_EQ(ffge_prim_i8(m_i8, 1, 1), 0b10110111);
 }
 
 static void test_ffge_prim_i8_two_01(void)
@@ -56,7 +73,8 @@ static void test_ffge_prim_i8_two_01(void)
 		m_i8[(1*2 + 1)*FFGE_WIDTH + k] = 0;
 	}
 
-	TEST_EQ(ffge_prim_i8(m_i8, 2), 0xff);
+	TEST_EQ(rank_i8(2, 2), 0xff);
+	TEST_EQ(ffge_prim_i8(m_i8, 2, 2), 0xff);
 }
 
 
@@ -70,11 +88,13 @@ static void test_ffge_prim_i8_two_02(void)
 	}
 	m_i8[(0*2 + 1)*FFGE_WIDTH + 4] = 0;
 
-	TEST_EQ(ffge_prim_i8(m_i8, 2), 0b11101111);
+	TEST_EQ(rank_i8(2, 2), 0b11101111);
+	TEST_EQ(ffge_prim_i8(m_i8, 2, 2), 0b11101111);
 }
 
-static void test_ffge_prim_i8_randrank(size_t n)
+static void test_ffge_prim_i8_randrank(size_t nr, size_t nc)
 {
+ const size_t nm = nr < nc ? nr : nc;
  for (size_t rep = 0; rep < REPS; rep++) {
 
 	uint8_t fl, fl_exp = 0;
@@ -82,21 +102,51 @@ static void test_ffge_prim_i8_randrank(size_t n)
 	/* generate random matrix; set ref. flags, pack it */
 	for (size_t k = 0; k < FFGE_WIDTH; k++) {
 		size_t rnk = (xoshiro256ss_next(&RNG) % 2) == 1 ?
-			n : xoshiro256ss_next(&RNG) % n;
-		if (rnk == n)
+			nm : xoshiro256ss_next(&RNG) % nm;
+		if (rnk == nm)
 			fl_exp |= (1 << k);
-		ffge_mat_genrand_prim(m, n, rnk, 99, &RNG);
-		for (size_t i = 0; i < n; i++)
-			for (size_t j = 0; j < n; j++)
-				m_i8[(i*n + j)*FFGE_WIDTH + k] = m[i*n + j];
+		ffge_mat_genrand_prim(m, nr, nc, rnk, 99, &RNG);
+		for (size_t i = 0; i < nr; i++)
+			for (size_t j = 0; j < nc; j++)
+				m_i8[(i*nc + j)*FFGE_WIDTH + k] = m[i*nc + j];
 	}
 
-	TEST_ASSERT((fl = ffge_prim_i8(m_i8, n)) == fl_exp,
-			"fl=%x, fl_exp=%x, n=%zu, rep=%zu",
-				fl, fl_exp, n, rep);
+	TEST_ASSERT((fl = rank_i8(nr, nc)) == fl_exp,
+			"rank: fl=%x, fl_exp=%x, nr=%zu, nc=%zu, rep=%zu",
+				fl, fl_exp, nr, nc, rep);
+	/* stop at the first singular matrix, or at a given one */
+	const uint8_t stop = rep % 3 == 0 ? 0xff : 1 << rep % FFGE_WIDTH;
+	memcpy(w, m_i8, nr * nc * FFGE_WIDTH * sizeof *m_i8);
+	fl = ffge_prim_i8_stop(w, nr, nc, stop);
+	TEST_ASSERT((fl & stop) == (fl_exp & stop) || ((fl & stop) != stop &&
+			(fl_exp & stop) != stop), "stop=%x, fl=%x, fl_exp=%x",
+				stop, fl, fl_exp);
+	TEST_ASSERT((~fl & fl_exp) == 0, "stop=%x, fl=%x, fl_exp=%x",
+				stop, fl, fl_exp);
+
+	TEST_ASSERT((fl = ffge_prim_i8(m_i8, nr, nc)) == fl_exp,
+			"fl=%x, fl_exp=%x, nr=%zu, nc=%zu, rep=%zu",
+				fl, fl_exp, nr, nc, rep);
  }
 }
 
+/* A wide matrix of full rank, whose first column is zero. */
+static void test_ffge_prim_i8_wide(void)
+{
+	for (size_t k = 0; k < FFGE_WIDTH; k++) {
+		m_i8[(0*3 + 0)*FFGE_WIDTH + k] = 0;
+		m_i8[(0*3 + 1)*FFGE_WIDTH + k] = 1;
+		m_i8[(0*3 + 2)*FFGE_WIDTH + k] = 0;
+		m_i8[(1*3 + 0)*FFGE_WIDTH + k] = 0;
+		m_i8[(1*3 + 1)*FFGE_WIDTH + k] = 0;
+		m_i8[(1*3 + 2)*FFGE_WIDTH + k] = 1;
+	}
+	m_i8[(1*3 + 2)*FFGE_WIDTH + 5] = 0;
+
+	TEST_EQ(rank_i8(2, 3), 0b11011111);
+	TEST_EQ(ffge_prim_i8(m_i8, 2, 3), 0b11011111);
+}
+
 static void test_ffge_prim_i8(void)
 {
 	test_ffge_prim_i8_unit();
@@ -104,10 +154,18 @@ static void test_ffge_prim_i8(void)
 	test_ffge_prim_i8_two_01();
 	test_ffge_prim_i8_two_02();
 
-	test_ffge_prim_i8_randrank(3);
-	test_ffge_prim_i8_randrank(6);
-	test_ffge_prim_i8_randrank(12);
-	test_ffge_prim_i8_randrank(23);
+	test_ffge_prim_i8_wide();
+
+	test_ffge_prim_i8_randrank(3, 3);
+	test_ffge_prim_i8_randrank(6, 6);
+	test_ffge_prim_i8_randrank(12, 12);
+	test_ffge_prim_i8_randrank(23, 23);
+
+	test_ffge_prim_i8_randrank(1, 5);
+	test_ffge_prim_i8_randrank(5, 1);
+	test_ffge_prim_i8_randrank(4, 9);
+	test_ffge_prim_i8_randrank(17, 6);
+	test_ffge_prim_i8_randrank(20, 28);
 }
 
 static void TEST_MAIN(void)
@@ -0,0 +1,204 @@
+/* -------------------------------------------------------------------------- *
+ * t-ffge_queue.c: Test the submission queue                                  *
+ *                                                                            *
+ * Copyright 2024 Marek Miller & ⧉⧉⧉                                          *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#include "test.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ffge.h"
+#include "utils.h"
+#include "xoshiro256ss.h"
+
+#define SEED UINT64_C(90013)
+static struct xoshiro256ss RNG;
+
+#define SIZE (5)
+#define COUNT (4096)
+#define PRODUCERS (4)
+#define CONSUMERS (3)
+
+static int64_t a[SIZE * SIZE];
+static int64_t mats[COUNT][SIZE * SIZE];
+static bool full_exp[COUNT];
+static bool full[COUNT];
+static _Atomic unsigned calls[COUNT];
+
+static void callback(void *tag, bool full_rank, void *data)
+{
+	const size_t i = (int64_t *)tag - mats[0];
+
+	TEST_EQ(data, (void *)&RNG);
+	full[i / (SIZE * SIZE)] = full_rank;
+	atomic_fetch_add(&calls[i / (SIZE * SIZE)], 1);
+}
+
+static void gen_mats(size_t nr, size_t nc)
+{
+	const size_t nm = nr < nc ? nr : nc;
+
+	for (size_t l = 0; l < COUNT; l++) {
+		size_t rnk = (xoshiro256ss_next(&RNG) % 2) == 1 ?
+			nm : xoshiro256ss_next(&RNG) % nm;
+		ffge_mat_genrand_prim(mats[l], nr, nc, rnk, 99, &RNG);
+		memcpy(a, mats[l], nr * nc * sizeof *a);
+		full_exp[l] = ffge_prim(a, nr, nc) == nm;
+		full[l] = !full_exp[l];
+		atomic_store(&calls[l], 0);
+	}
+}
+
+static void check_mats(size_t count)
+{
+	for (size_t l = 0; l < count; l++) {
+		TEST_ASSERT(atomic_load(&calls[l]) == 1, "calls[%zu]=%u", l,
+			atomic_load(&calls[l]));
+		TEST_ASSERT(full[l] == full_exp[l], "full[%zu]", l);
+	}
+}
+
+static void test_ffge_queue_groups(size_t nr, size_t nc)
+{
+	static alignas(64) int64_t w[SIZE * SIZE * FFGE_WIDTH];
+	struct ffge_queue_stats st;
+	struct ffge_queue *q;
+
+	gen_mats(nr, nc);
+	q = ffge_queue_create(nr, nc, 16, UINT64_MAX, callback, &RNG);
+	TEST_ASSERT(q != nullptr, "cannot create queue");
+	if (!q)
+		return;
+
+	TEST_EQ(ffge_queue_poll(q, true, w), 0);
+	for (size_t l = 0; l < 13; l++)
+		TEST_ASSERT(ffge_queue_submit(q, mats[l], mats[l]), "submit");
+	TEST_EQ(ffge_queue_poll(q, false, w), FFGE_WIDTH);
+	TEST_EQ(ffge_queue_poll(q, false, w), 0);	/* deadline */
+	TEST_EQ(ffge_queue_poll(q, true, w), 5);
+	TEST_EQ(ffge_queue_poll(q, true, w), 0);
+
+	/* fill the queue */
+	for (size_t l = 13; l < 13 + 16; l++)
+		TEST_ASSERT(ffge_queue_submit(q, mats[l], mats[l]), "submit");
+	TEST_ASSERT(!ffge_queue_submit(q, mats[29], mats[29]), "full");
+	TEST_EQ(ffge_queue_poll(q, false, w), FFGE_WIDTH);
+	TEST_EQ(ffge_queue_poll(q, false, w), FFGE_WIDTH);
+	TEST_EQ(ffge_queue_poll(q, false, w), 0);
+	check_mats(29);
+
+	ffge_queue_get_stats(q, &st);
+	TEST_EQ(st.submitted, 29);
+	TEST_EQ(st.rejected, 1);
+	TEST_EQ(st.groups, 4);
+	TEST_EQ(st.partial, 1);
+	TEST_EQ(st.lanes, 29);
+	ffge_queue_destroy(q);
+	ffge_queue_destroy(nullptr);
+}
+
+static void test_ffge_queue_deadline(void)
+{
+	static alignas(64) int64_t w[SIZE * SIZE * FFGE_WIDTH];
+	struct ffge_queue *q;
+
+	gen_mats(SIZE, SIZE);
+	q = ffge_queue_create(SIZE, SIZE, 1, 0, callback, &RNG);
+	TEST_ASSERT(q != nullptr, "cannot create queue");
+	if (!q)
+		return;
+
+	for (size_t l = 0; l < 3; l++)
+		TEST_ASSERT(ffge_queue_submit(q, mats[l], mats[l]), "submit");
+	TEST_EQ(ffge_queue_poll(q, false, w), 3);
+	check_mats(3);
+	ffge_queue_destroy(q);
+}
+
+static struct ffge_queue *Q;
+static _Atomic size_t DONE;
+
+static void *producer(void *arg)
+{
+	const size_t p = (size_t)arg;
+
+	for (size_t l = p; l < COUNT; l += PRODUCERS)
+		while (!ffge_queue_submit(Q, mats[l], mats[l]))
+			sched_yield();
+
+	return nullptr;
+}
+
+static void *consumer(void *)
+{
+	static alignas(64) thread_local int64_t w[SIZE * SIZE * FFGE_WIDTH];
+
+	while (atomic_load(&DONE) < COUNT) {
+		const size_t k = ffge_queue_poll(Q, false, w);
+		if (k == 0)
+			sched_yield();
+		atomic_fetch_add(&DONE, k);
+	}
+
+	return nullptr;
+}
+
+static void test_ffge_queue_threads(uint64_t deadline)
+{
+	pthread_t prod[PRODUCERS], cons[CONSUMERS];
+	struct ffge_queue_stats st;
+
+	gen_mats(SIZE, SIZE);
+	Q = ffge_queue_create(SIZE, SIZE, 64, deadline, callback, &RNG);
+	TEST_ASSERT(Q != nullptr, "cannot create queue");
+	if (!Q)
+		return;
+	atomic_store(&DONE, 0);
+
+	for (size_t t = 0; t < CONSUMERS; t++)
+		pthread_create(&cons[t], nullptr, consumer, nullptr);
+	for (size_t t = 0; t < PRODUCERS; t++)
+		pthread_create(&prod[t], nullptr, producer, (void *)t);
+	for (size_t t = 0; t < PRODUCERS; t++)
+		pthread_join(prod[t], nullptr);
+	for (size_t t = 0; t < CONSUMERS; t++)
+		pthread_join(cons[t], nullptr);
+	check_mats(COUNT);
+
+	ffge_queue_get_stats(Q, &st);
+	TEST_EQ(st.submitted, COUNT);
+	TEST_EQ(st.lanes, COUNT);
+	TEST_ASSERT(st.groups >= COUNT / FFGE_WIDTH, "groups=%lu", st.groups);
+	ffge_queue_destroy(Q);
+}
+
+static void TEST_MAIN(void)
+{
+	xoshiro256ss_init(&RNG, SEED);
+
+	test_ffge_queue_groups(SIZE, SIZE);
+	test_ffge_queue_groups(3, SIZE);
+	test_ffge_queue_groups(SIZE, 2);
+	test_ffge_queue_deadline();
+
+	test_ffge_queue_threads(0);
+	test_ffge_queue_threads(100000);
+}
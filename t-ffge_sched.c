@@ -0,0 +1,132 @@
+/* -------------------------------------------------------------------------- *
+ * t-ffge_sched.c: Test the scheduler of matrices of different sizes          *
+ *                                                                            *
+ * Copyright 2024 Marek Miller & ⧉⧉⧉                                          *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#include "test.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ffge.h"
+#include "utils.h"
+#include "xoshiro256ss.h"
+
+#define SEED UINT64_C(3840)
+static struct xoshiro256ss RNG;
+
+#define MAX_SIZE (20)
+#define COUNT (333)
+
+static int64_t a[MAX_SIZE * MAX_SIZE];
+static int64_t mats[COUNT][MAX_SIZE * MAX_SIZE];
+static const int64_t *ptrs[COUNT];
+static size_t sizes[COUNT];
+static bool full[COUNT], full_exp[COUNT];
+
+static void gen_mats(size_t count, size_t nmin, size_t nmax)
+{
+	for (size_t l = 0; l < count; l++) {
+		const size_t n = nmin +
+			xoshiro256ss_next(&RNG) % (nmax - nmin + 1);
+		size_t rnk = (xoshiro256ss_next(&RNG) % 2) == 1 ?
+			n : xoshiro256ss_next(&RNG) % n;
+		ffge_mat_genrand_prim(mats[l], n, n, rnk, 99, &RNG);
+		memcpy(a, mats[l], n * n * sizeof *a);
+		full_exp[l] = ffge_prim(a, n, n) == n;
+		full[l] = !full_exp[l];
+		ptrs[l] = mats[l];
+		sizes[l] = n;
+	}
+}
+
+static void check_mats(size_t count, size_t pad)
+{
+	for (size_t l = 0; l < count; l++)
+		TEST_ASSERT(full[l] == full_exp[l], "l=%zu, n=%zu, pad=%zu",
+			l, sizes[l], pad);
+}
+
+static void test_ffge_sched_unit(void)
+{
+	struct ffge_sched_stats st;
+
+	/* seven matrices of size 3 and one of size 4 */
+	gen_mats(8, 3, 3);
+	sizes[5] = 4;
+	ffge_mat_genrand_prim(mats[5], 4, 4, 2, 99, &RNG);
+	full_exp[5] = false;
+
+	TEST_EQ(ffge_sched_i8(ptrs, sizes, 8, 0, full, &st), 0);
+	check_mats(8, 0);
+	TEST_EQ(st.groups, 2);
+	TEST_EQ(st.partial, 2);
+	TEST_EQ(st.padded, 0);
+	TEST_EQ(st.cost, 3*3*19 + 4*4*20);
+
+	TEST_EQ(ffge_sched_i8(ptrs, sizes, 8, 1, full, &st), 0);
+	check_mats(8, 1);
+	TEST_EQ(st.groups, 1);
+	TEST_EQ(st.partial, 0);
+	TEST_EQ(st.padded, 7);
+	TEST_EQ(st.cost, 4*4*20);
+
+	TEST_EQ(ffge_sched_i8(ptrs, sizes, 0, 1, full, &st), 0);
+	TEST_EQ(st.groups, 0);
+}
+
+static void test_ffge_sched_rand(size_t nmin, size_t nmax)
+{
+	struct ffge_sched_stats st;
+	uint64_t groups_exp = 0, cost;
+	size_t cnt[MAX_SIZE + 1] = { 0 };
+
+	gen_mats(COUNT, nmin, nmax);
+	for (size_t l = 0; l < COUNT; l++)
+		cnt[sizes[l]]++;
+	for (size_t n = 1; n <= MAX_SIZE; n++)
+		groups_exp += (cnt[n] + FFGE_WIDTH - 1) / FFGE_WIDTH;
+
+	TEST_EQ(ffge_sched_i8(ptrs, sizes, COUNT, 0, full, &st), 0);
+	check_mats(COUNT, 0);
+	TEST_EQ(st.groups, groups_exp);
+	TEST_EQ(st.padded, 0);
+
+	cost = st.cost;
+	for (size_t pad = 1; pad <= nmax - nmin; pad++) {
+		for (size_t l = 0; l < COUNT; l++)
+			full[l] = !full_exp[l];
+		TEST_EQ(ffge_sched_i8(ptrs, sizes, COUNT, pad, full, &st), 0);
+		check_mats(COUNT, pad);
+		TEST_ASSERT(st.cost <= cost, "pad=%zu", pad);
+		TEST_ASSERT(st.groups >= COUNT / FFGE_WIDTH, "pad=%zu", pad);
+		cost = st.cost;
+	}
+	/* not worse than all matrices padded to the largest size */
+	TEST_ASSERT(st.cost <= (COUNT + FFGE_WIDTH - 1) / FFGE_WIDTH *
+		nmax*nmax*(nmax + 16), "cost=%lu", st.cost);
+}
+
+static void TEST_MAIN(void)
+{
+	xoshiro256ss_init(&RNG, SEED);
+
+	test_ffge_sched_unit();
+	test_ffge_sched_rand(1, 6);
+	test_ffge_sched_rand(3, 20);
+	test_ffge_sched_rand(12, 14);
+}
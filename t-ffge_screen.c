@@ -0,0 +1,133 @@
+/* -------------------------------------------------------------------------- *
+ * t-ffge_screen.c: Test the implementation of ffge_screen_i32.               *
+ *                                                                            *
+ * Copyright 2024 ⧉⧉⧉                                                         *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#include "test.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ffge.h"
+#include "utils.h"
+#include "xoshiro256ss.h"
+
+#define REPS (99L)
+
+#define SEED UINT64_C(32717)
+static struct xoshiro256ss RNG;
+
+#define MAX_SIZE (16)
+static int64_t a[MAX_SIZE * MAX_SIZE];
+static alignas(64) int64_t m[MAX_SIZE * MAX_SIZE * FFGE_WIDTH16];
+static alignas(64) int64_t m_cp[MAX_SIZE * MAX_SIZE * FFGE_WIDTH16];
+static alignas(64) int64_t w[FFGE_SCREEN_WORK(MAX_SIZE, MAX_SIZE)];
+
+/* Store the matrix a at index k of m, packed as in ffge_screen_i32(). */
+static void pack(int64_t *m, size_t k, const int64_t *a, size_t nr, size_t nc)
+{
+	const size_t ne = nr * nc;
+
+	for (size_t e = 0; e < ne; e++)
+		m[((k/FFGE_WIDTH)*ne + e)*FFGE_WIDTH + k%FFGE_WIDTH] = a[e];
+}
+
+static void test_ffge_screen_one(void)
+{
+	struct ffge_screen_stats st = { 0 };
+
+	/* singular modulo FFGE_PRIM16 only */
+	for (size_t k = 0; k < FFGE_WIDTH16; k++)
+		m[k] = k == 3 ? FFGE_PRIM16 : 1;
+	TEST_EQ(ffge_screen_i32(m, 1, 1, true, w, &st), 0xffffffff);
+	TEST_EQ(ffge_screen_i32(m, 1, 1, false, w, &st), 0xfffffff7);
+	TEST_EQ(st.lanes, 2 * FFGE_WIDTH16);
+	TEST_EQ(st.full, 2 * FFGE_WIDTH16 - 2);
+	TEST_EQ(st.checked, 1);
+	TEST_EQ(st.singular, 0);
+	TEST_EQ(st.calls_i8, 1);
+
+	/* singular modulo FFGE_PRIM only, reported as full-rank */
+	m[3] = FFGE_PRIM;
+	m[5] = 0;
+	m[30] = -FFGE_PRIM16;
+	st = (struct ffge_screen_stats){ 0 };
+	TEST_EQ(ffge_screen_i32(m, 1, 1, true, w, &st), 0xffffffdf);
+	TEST_EQ(st.checked, 2);
+	TEST_EQ(st.singular, 1);
+	TEST_EQ(m[3], FFGE_PRIM);
+
+	/* elements out of the range of the vectorized reduction */
+	for (size_t k = 0; k < FFGE_WIDTH16; k++)
+		m[k] = k + (INT64_C(1) << 60);
+	m[7] = FFGE_PRIM16 * (INT64_C(1) << 40);
+	m[9] = -FFGE_PRIM16 * (INT64_C(1) << 45);
+	m[12] = 0;
+	TEST_EQ(ffge_screen_i32(m, 1, 1, false, w, nullptr), 0xffffed7f);
+	TEST_EQ(ffge_screen_i32(m, 1, 1, true, w, nullptr), 0xffffefff);
+}
+
+static void test_ffge_screen_randrank(size_t nr, size_t nc)
+{
+	const size_t nm = nr < nc ? nr : nc;
+	const size_t ne = nr * nc;
+	struct ffge_screen_stats st = { 0 };
+	uint32_t fl, fl_exp;
+
+	for (size_t rep = 0; rep < REPS; rep++) {
+		fl_exp = 0;
+		for (size_t k = 0; k < FFGE_WIDTH16; k++) {
+			size_t rnk = (xoshiro256ss_next(&RNG) % 2) == 1 ?
+				nm : xoshiro256ss_next(&RNG) % nm;
+			ffge_mat_genrand_prim(a, nr, nc, rnk, 99, &RNG);
+			pack(m, k, a, nr, nc);
+			if (rnk == nm)
+				fl_exp |= UINT32_C(1) << k;
+		}
+		for (size_t i = 0; i < ne * FFGE_WIDTH16; i++)
+			m_cp[i] = m[i];
+
+		TEST_ASSERT((fl = ffge_screen_i32(m, nr, nc, true, w, &st))
+				== fl_exp,
+			"fl=%x, fl_exp=%x, nr=%zu, nc=%zu, rep=%zu",
+				fl, fl_exp, nr, nc, rep);
+		TEST_ASSERT((fl = ffge_screen_i32(m, nr, nc, false, w, &st))
+				== fl_exp,
+			"fl=%x, fl_exp=%x, nr=%zu, nc=%zu, rep=%zu",
+				fl, fl_exp, nr, nc, rep);
+
+		bool same = true;
+		for (size_t i = 0; i < ne * FFGE_WIDTH16; i++)
+			same &= m_cp[i] == m[i];
+		TEST_ASSERT(same, "input modified, nr=%zu, nc=%zu", nr, nc);
+	}
+	TEST_EQ(st.lanes, 2 * REPS * FFGE_WIDTH16);
+	TEST_EQ(st.full + 2 * st.checked, st.lanes);
+	TEST_EQ(st.singular, st.checked);
+}
+
+static void TEST_MAIN(void)
+{
+	xoshiro256ss_init(&RNG, SEED);
+
+	test_ffge_screen_one();
+
+	test_ffge_screen_randrank(2, 2);
+	test_ffge_screen_randrank(7, 7);
+	test_ffge_screen_randrank(16, 16);
+	test_ffge_screen_randrank(5, 12);
+	test_ffge_screen_randrank(13, 6);
+}
@@ -0,0 +1,114 @@
+/* -------------------------------------------------------------------------- *
+ * t-ffge_sparse.c: Test the implementation of ffge_sparse_rank               *
+ *                                                                            *
+ * Copyright 2024 Marek Miller & ⧉⧉⧉                                          *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#include "test.h"
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ffge.h"
+#include "utils.h"
+#include "xoshiro256ss.h"
+
+#define REPS (99L)
+
+#define SEED UINT64_C(61331)
+static struct xoshiro256ss RNG;
+
+#define MAX_SIZE (40)
+static int64_t a[MAX_SIZE * MAX_SIZE], b[MAX_SIZE * MAX_SIZE];
+static size_t rp[MAX_SIZE + 1], ci[MAX_SIZE * MAX_SIZE];
+static int64_t v[MAX_SIZE * MAX_SIZE];
+
+static void test_ffge_sparse_unit(void)
+{
+	struct ffge_sparse_stats st;
+
+	/* zeros in the input, and elements that vanish modulo p */
+	const size_t rp1[] = { 0, 2, 3 }, ci1[] = { 0, 1, 1 };
+	const int64_t v1[] = { 0, FFGE_PRIM, 7 };
+	TEST_EQ(ffge_sparse_rank(rp1, ci1, v1, 2, 2, 2.0, &st), 1);
+	TEST_EQ(st.pivots, 1);
+	TEST_EQ(st.dense_nr, 0);
+
+	/* the second row cancels out */
+	const size_t rp2[] = { 0, 2, 4 }, ci2[] = { 0, 2, 0, 2 };
+	const int64_t v2[] = { 2, 3, 4, 6 };
+	TEST_EQ(ffge_sparse_rank(rp2, ci2, v2, 2, 3, 2.0, &st), 1);
+	TEST_EQ(st.fill, 0);
+
+	/* an arrow matrix: no fill-in, unless pivoted at the dense row */
+	const size_t rp3[] = { 0, 3, 5, 7 }, ci3[] = { 0, 1, 2, 0, 1, 0, 2 };
+	const int64_t v3[] = { 1, 1, 1, 1, 2, 1, 3 };
+	TEST_EQ(ffge_sparse_rank(rp3, ci3, v3, 3, 3, 2.0, &st), 3);
+	TEST_EQ(st.pivots, 3);
+	TEST_EQ(st.fill, 0);
+	TEST_EQ(ffge_sparse_rank(rp3, ci3, v3, 3, 3, 0.0, &st), 3);
+	TEST_EQ(st.pivots, 0);
+	TEST_EQ(st.dense_nr, 3);
+
+	const size_t rp0[] = { 0, 0, 0 };
+	TEST_EQ(ffge_sparse_rank(rp0, ci, v, 2, 5, 2.0, &st), 0);
+	TEST_EQ(ffge_sparse_rank(rp0, ci, v, 0, 5, 2.0, nullptr), 0);
+}
+
+static void test_ffge_sparse_rank(size_t nr, size_t nc, size_t d,
+		double dense)
+{
+	const size_t nm = nr < nc ? nr : nc;
+	for (size_t rep = 0; rep < REPS; rep++) {
+		struct ffge_sparse_stats st;
+		const size_t rnk = xoshiro256ss_next(&RNG) % 2 ?
+			nm : xoshiro256ss_next(&RNG) % (nm + 1);
+		const size_t rnk_exp = ffge_mat_genrand_sparse(a, b, nr, nc,
+			rnk, d, &RNG);
+		ffge_mat_to_csr(a, nr, nc, rp, ci, v);
+
+		size_t rnk_sp = ffge_sparse_rank(rp, ci, v, nr, nc, dense, &st);
+		TEST_ASSERT(rnk_sp == rnk_exp, "rnk=%zu, rnk_exp=%zu, "
+			"nr=%zu, nc=%zu, d=%zu, dense=%g, rep=%zu", rnk_sp,
+				rnk_exp, nr, nc, d, dense, rep);
+		TEST_ASSERT(st.pivots <= rnk_sp && st.nnz_peak >= rp[nr] &&
+			st.dense_nr <= nr - st.pivots &&
+			(dense <= 1.0 || st.dense_nr == 0),
+			"pivots=%" PRIu64 ", nnz_peak=%" PRIu64
+			", dense_nr=%" PRIu64, st.pivots, st.nnz_peak,
+				st.dense_nr);
+	}
+}
+
+static void TEST_MAIN(void)
+{
+	xoshiro256ss_init(&RNG, SEED);
+
+	test_ffge_sparse_unit();
+
+	const size_t sizes[][2] = {
+		{ 1, 1 }, { 2, 2 }, { 5, 5 }, { 13, 13 },
+		{ MAX_SIZE, MAX_SIZE }, { 3, 11 }, { 17, 6 }, { 29, MAX_SIZE }
+	};
+	const double dense[] = { 0.0, FFGE_SPARSE_DENSE, 0.5, 2.0 };
+	for (size_t i = 0; i < sizeof sizes / sizeof *sizes; i++)
+		for (size_t l = 0; l < sizeof dense / sizeof *dense; l++) {
+			test_ffge_sparse_rank(sizes[i][0], sizes[i][1], 2,
+				dense[l]);
+			test_ffge_sparse_rank(sizes[i][0], sizes[i][1], 7,
+				dense[l]);
+		}
+}
@@ -0,0 +1,109 @@
+/* -------------------------------------------------------------------------- *
+ * t-ffge_stats.c: Test the instrumentation build.                            *
+ *                                                                            *
+ * Copyright 2024 ⧉⧉⧉                                                         *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#include "test.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ffge.h"
+#include "utils.h"
+#include "xoshiro256ss.h"
+
+#ifdef FFGE_STATS
+
+#define REPS (99L)
+
+#define SEED UINT64_C(8812)
+static struct xoshiro256ss RNG;
+
+#define MAX_SIZE (16)
+static int64_t m[MAX_SIZE * MAX_SIZE];
+static alignas(64) int64_t m_i8[MAX_SIZE * MAX_SIZE * FFGE_WIDTH];
+
+static void test_ffge_stats_two(void)
+{
+	struct ffge_stats st;
+
+	ffge_stats_reset();
+	int64_t m0[4] = { 0, 1, 1, 0 };
+	TEST_EQ(ffge_prim(m0, 2, 2), 2);
+	ffge_stats_get(&st);
+	TEST_EQ(st.steps, 2);
+	TEST_EQ(st.swaps, 1);
+	TEST_EQ(st.singular, 0);
+
+	ffge_stats_reset();
+	int64_t m1[4] = { 1, 2, 2, 4 };
+	TEST_EQ(ffge_prim(m1, 2, 2), 1);
+	ffge_stats_get(&st);
+	TEST_EQ(st.steps, 2);
+	TEST_EQ(st.swaps, 0);
+	TEST_EQ(st.singular, 1);
+	TEST_EQ(st.singular_at[1], 1);
+
+	ffge_stats_reset();
+	ffge_stats_get(&st);
+	TEST_EQ(st.steps, 0);
+	TEST_EQ(st.singular_at[1], 0);
+}
+
+static void test_ffge_stats_i8(size_t n)
+{
+	struct ffge_stats st;
+	uint64_t sing = 0;
+
+	ffge_stats_reset();
+	for (size_t rep = 0; rep < REPS; rep++) {
+		for (size_t k = 0; k < FFGE_WIDTH; k++) {
+			const size_t rnk = xoshiro256ss_next(&RNG) % (n + 1);
+			ffge_mat_genrand_prim(m, n, n, rnk, 99, &RNG);
+			for (size_t i = 0; i < n*n; i++)
+				m_i8[i*FFGE_WIDTH + k] = m[i];
+		}
+		const uint8_t fl = ffge_prim_i8(m_i8, n, n);
+		sing += FFGE_WIDTH - __builtin_popcount(fl);
+	}
+	ffge_stats_get(&st);
+
+	uint64_t sum = 0;
+	for (size_t s = 0; s < FFGE_STATS_STEPS; s++)
+		sum += st.singular_at[s];
+	TEST_EQ(st.singular, sing);
+	TEST_EQ(sum, sing);
+	TEST_ASSERT(st.steps > 0 && st.steps <= REPS * n,
+		"steps=%lu, n=%zu", (unsigned long)st.steps, n);
+}
+
+static void TEST_MAIN(void)
+{
+	xoshiro256ss_init(&RNG, SEED);
+
+	test_ffge_stats_two();
+	test_ffge_stats_i8(3);
+	test_ffge_stats_i8(12);
+}
+
+#else
+
+static void TEST_MAIN(void)
+{
+	/* Nothing to test, unless compiled with -DFFGE_STATS */
+}
+
+#endif /* FFGE_STATS */
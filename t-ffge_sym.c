@@ -0,0 +1,151 @@
+/* -------------------------------------------------------------------------- *
+ * t-ffge_sym.c: Test elimination of symmetric matrices                       *
+ *                                                                            *
+ * Copyright 2024 Marek Miller & ⧉⧉⧉                                          *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#include "test.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ffge.h"
+#include "utils.h"
+#include "xoshiro256ss.h"
+
+#define REPS (199L)
+
+#define SEED UINT64_C(55117)
+static struct xoshiro256ss RNG;
+
+#define MAX_SIZE (30)
+static int64_t a[MAX_SIZE * MAX_SIZE], b[MAX_SIZE * MAX_SIZE];
+static int64_t m[FFGE_SYM_SIZE(MAX_SIZE)];
+static alignas(64) int64_t m_i8[FFGE_SYM_SIZE(MAX_SIZE) * FFGE_WIDTH];
+
+/* Store the upper triangle of a in m, lane k of w packed matrices. */
+static void pack_sym(const int64_t *a, size_t n, int64_t *m, size_t w,
+		size_t k)
+{
+	size_t l = 0;
+	for (size_t i = 0; i < n; i++)
+		for (size_t j = i; j < n; j++)
+			m[(l++)*w + k] = a[i*n + j];
+}
+
+/* Generate a random symmetric matrix in a, return its rank.  For adj, the
+ * matrix is an adjacency matrix of a random graph, with zero diagonal.
+ */
+static size_t gen_sym(size_t n, bool adj)
+{
+	if (adj) {
+		for (size_t i = 0; i < n; i++) {
+			a[i*n + i] = 0;
+			for (size_t j = i + 1; j < n; j++)
+				a[i*n + j] = a[j*n + i] =
+					xoshiro256ss_next(&RNG) % 4 == 0;
+		}
+	} else {
+		size_t rnk = (xoshiro256ss_next(&RNG) % 2) == 1 ?
+			n : xoshiro256ss_next(&RNG) % n;
+		ffge_mat_genrand_sym(a, n, rnk, 99, &RNG);
+	}
+	memcpy(b, a, n * n * sizeof *a);
+
+	return ffge_prim(b, n, n);
+}
+
+static void test_ffge_sym_unit(void)
+{
+	/* zero diagonal: the pivot is made by a congruence */
+	const int64_t a2[] = { 0, 1, 1, 0 };
+	pack_sym(a2, 2, m, 1, 0);
+	TEST_EQ(ffge_sym_prim(m, 2), 2);
+
+	const int64_t a3[] = { 0, 0, 5, 0, 0, 0, 5, 0, 0 };
+	pack_sym(a3, 3, m, 1, 0);
+	TEST_EQ(ffge_sym_prim(m, 3), 2);
+
+	const int64_t a4[] = { 0, 0, 0, 0 };
+	pack_sym(a4, 2, m, 1, 0);
+	TEST_EQ(ffge_sym_prim(m, 2), 0);
+
+	/* the diagonal element FFGE_PRIM - 1 + 1 vanishes modulo p */
+	const int64_t a5[] = { FFGE_PRIM - 1, 1, 1, FFGE_PRIM - 1 };
+	pack_sym(a5, 2, m, 1, 0);
+	TEST_EQ(ffge_sym_prim(m, 2), 1);
+
+	/* a swap, then a congruence at the second step: the columns of the
+	 * first row of the echelon form follow */
+	const int64_t a6[] = { 1, 1, 0, 1, 1, 1, 0, 1, 5 };
+	const int64_t m6[] = { 1, 0, 1, 5, 1, -1 };
+	pack_sym(a6, 3, m, 1, 0);
+	TEST_EQ(ffge_sym_prim(m, 3), 3);
+	TEST_ASSERT(memcmp(m, m6, sizeof m6) == 0, "swap");
+
+	const int64_t a7[] = { 1, 1, 1, 1, 1, 2, 1, 2, 1 };
+	const int64_t m7[] = { 1, 2, 1, 2, 1, -1 };
+	pack_sym(a7, 3, m, 1, 0);
+	TEST_EQ(ffge_sym_prim(m, 3), 3);
+	TEST_ASSERT(memcmp(m, m7, sizeof m7) == 0, "congruence");
+
+	TEST_EQ(ffge_sym_prim(m, 0), 0);
+	TEST_EQ(ffge_sym_prim_i8(m_i8, 0), 0xff);
+}
+
+static void test_ffge_sym_prim(size_t n, bool adj)
+{
+	for (size_t rep = 0; rep < REPS; rep++) {
+		const size_t rnk_exp = gen_sym(n, adj);
+		pack_sym(a, n, m, 1, 0);
+
+		size_t rnk = ffge_sym_prim(m, n);
+		TEST_ASSERT(rnk == rnk_exp, "rnk=%zu, rnk_exp=%zu, n=%zu, "
+			"adj=%d, rep=%zu", rnk, rnk_exp, n, adj, rep);
+	}
+}
+
+static void test_ffge_sym_prim_i8(size_t n, bool adj)
+{
+	for (size_t rep = 0; rep < REPS; rep++) {
+		uint8_t fl, fl_exp = 0;
+
+		for (size_t k = 0; k < FFGE_WIDTH; k++) {
+			if (gen_sym(n, adj) == n)
+				fl_exp |= 1 << k;
+			pack_sym(a, n, m_i8, FFGE_WIDTH, k);
+		}
+
+		TEST_ASSERT((fl = ffge_sym_prim_i8(m_i8, n)) == fl_exp,
+			"fl=%x, fl_exp=%x, n=%zu, adj=%d, rep=%zu",
+				fl, fl_exp, n, adj, rep);
+	}
+}
+
+static void TEST_MAIN(void)
+{
+	xoshiro256ss_init(&RNG, SEED);
+
+	test_ffge_sym_unit();
+
+	const size_t sizes[] = { 1, 2, 3, 6, 11, 17, MAX_SIZE };
+	for (size_t i = 0; i < sizeof sizes / sizeof *sizes; i++) {
+		test_ffge_sym_prim(sizes[i], false);
+		test_ffge_sym_prim(sizes[i], true);
+		test_ffge_sym_prim_i8(sizes[i], false);
+		test_ffge_sym_prim_i8(sizes[i], true);
+	}
+}
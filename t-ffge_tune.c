@@ -0,0 +1,148 @@
+/* -------------------------------------------------------------------------- *
+ * t-ffge_tune.c: Test the dispatcher of the rank kernels                     *
+ *                                                                            *
+ * Copyright 2024 Marek Miller & ⧉⧉⧉                                          *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#define _POSIX_C_SOURCE 200809L
+
+#include "test.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ffge.h"
+#include "utils.h"
+#include "xoshiro256ss.h"
+
+#define SEED UINT64_C(770341)
+static struct xoshiro256ss RNG;
+
+#define MAX_SIZE (24)
+#define MAX_COUNT (19)
+
+static int64_t a[MAX_SIZE * MAX_SIZE];
+static int64_t mats[MAX_COUNT * MAX_SIZE * MAX_SIZE];
+static size_t rank[MAX_COUNT], rank_exp[MAX_COUNT];
+
+static const char *const KERNELS[] = {
+	"ffge_prim",
+	"ffge_prim_i8",
+	"ffge_prim_kernel_i8",
+};
+
+static void test_ffge_rank_auto(size_t nr, size_t nc, size_t count)
+{
+	const size_t ne = nr * nc, nm = nr < nc ? nr : nc;
+
+	for (size_t l = 0; l < count; l++) {
+		size_t rnk = (xoshiro256ss_next(&RNG) % 2) == 1 ?
+			nm : xoshiro256ss_next(&RNG) % nm;
+		ffge_mat_genrand_prim(mats + l*ne, nr, nc, rnk, 99, &RNG);
+		memcpy(a, mats + l*ne, ne * sizeof *a);
+		rank_exp[l] = ffge_prim(a, nr, nc);
+		rank[l] = SIZE_MAX;
+	}
+
+	TEST_EQ(ffge_rank_auto(mats, nr, nc, count, rank), 0);
+	for (size_t l = 0; l < count; l++)
+		TEST_ASSERT(rank[l] == rank_exp[l], "nr=%zu, nc=%zu, "
+			"count=%zu, l=%zu, kernel=%s", nr, nc, count, l,
+			ffge_rank_auto_kernel(nr, nc, count));
+}
+
+static void test_ffge_rank_auto_sizes(void)
+{
+	const size_t counts[] = { 1, 3, 8, 11, MAX_COUNT };
+
+	for (size_t c = 0; c < sizeof counts / sizeof *counts; c++) {
+		test_ffge_rank_auto(1, 1, counts[c]);
+		test_ffge_rank_auto(4, 4, counts[c]);
+		test_ffge_rank_auto(9, 9, counts[c]);
+		test_ffge_rank_auto(MAX_SIZE, MAX_SIZE, counts[c]);
+		test_ffge_rank_auto(3, 7, counts[c]);
+		test_ffge_rank_auto(10, 5, counts[c]);
+	}
+}
+
+static void write_plan(const char *path, const char *body)
+{
+	FILE *f = fopen(path, "w");
+	TEST_ASSERT(f != nullptr, "cannot write %s", path);
+	if (!f)
+		return;
+	fputs(body, f);
+	fclose(f);
+}
+
+static void test_ffge_plan_load(void)
+{
+	static char body[16384];
+	char path[] = "/tmp/t-ffge_tune.XXXXXX";
+	const int fd = mkstemp(path);
+	TEST_ASSERT(fd >= 0, "mkstemp");
+	if (fd < 0)
+		return;
+	close(fd);
+
+	for (size_t k = 0; k < sizeof KERNELS / sizeof *KERNELS; k++) {
+		size_t len = sprintf(body, "# ffge plan 1\n# comment\n\n");
+		for (size_t n = 2; n <= 64; n++)
+			for (size_t c = 1; c <= 64; c *= 2)
+				len += sprintf(body + len, "%zu %zu %s\n",
+					n, c, KERNELS[k]);
+		TEST_ASSERT(len < sizeof body, "body");
+		write_plan(path, body);
+
+		TEST_EQ(ffge_plan_load(path), 0);
+		TEST_ASSERT(strcmp(ffge_rank_auto_kernel(5, 5, 9),
+			KERNELS[k]) == 0, "k=%zu", k);
+		TEST_ASSERT(strcmp(ffge_rank_auto_kernel(100, 1, 1000),
+			KERNELS[k]) == 0, "k=%zu", k);
+		test_ffge_rank_auto_sizes();
+	}
+
+	/* entries missing from the plan are set to defaults */
+	write_plan(path, "# ffge plan 1\n4 8 ffge_prim_kernel_i8\n");
+	TEST_EQ(ffge_plan_load(path), 0);
+	TEST_ASSERT(strcmp(ffge_rank_auto_kernel(4, 3, 15),
+		"ffge_prim_kernel_i8") == 0, "plan");
+	TEST_ASSERT(strcmp(ffge_rank_auto_kernel(4, 3, 1),
+		"ffge_prim") == 0, "default");
+	TEST_ASSERT(strcmp(ffge_rank_auto_kernel(5, 5, 8),
+		"ffge_prim_i8") == 0, "default");
+
+	/* invalid plans leave the current one intact */
+	write_plan(path, "# ffge plan 1\n4 8 ffge\n");
+	TEST_EQ(ffge_plan_load(path), -1);
+	write_plan(path, "4 8 ffge_prim\n");
+	TEST_EQ(ffge_plan_load(path), -1);
+	TEST_ASSERT(strcmp(ffge_rank_auto_kernel(4, 3, 15),
+		"ffge_prim_kernel_i8") == 0, "plan");
+	unlink(path);
+	TEST_EQ(ffge_plan_load(path), -1);
+}
+
+static void TEST_MAIN(void)
+{
+	xoshiro256ss_init(&RNG, SEED);
+
+	test_ffge_rank_auto_sizes();
+	test_ffge_plan_load();
+}
@@ -0,0 +1,144 @@
+/* -------------------------------------------------------------------------- *
+ * t-ffge_wiedemann.c: Test the implementation of ffge_wiedemann_rank         *
+ *                                                                            *
+ * Copyright 2024 Marek Miller & ⧉⧉⧉                                          *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU General Public License as published by the      *
+ * Free Software Foundation, either version 3 of the License, or (at your     *
+ * option) any later version.                                                 *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful, but        *
+ * WITHOUT ANY WARRANTY* without even the implied warranty of MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License   *
+ * for more details.                                                          *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License along    *
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.           *
+ * -------------------------------------------------------------------------- */
+#include "test.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ffge.h"
+#include "utils.h"
+#include "xoshiro256ss.h"
+
+#define REPS (49L)
+
+#define SEED UINT64_C(70001)
+static struct xoshiro256ss RNG;
+
+#define MAX_SIZE (40)
+static int64_t a[MAX_SIZE * MAX_SIZE], b[MAX_SIZE * MAX_SIZE];
+
+#define LARGE_SIZE (600)
+#define LARGE_PER_ROW (3)
+static size_t rp[LARGE_SIZE + 1], ci[LARGE_SIZE * MAX_SIZE];
+static int64_t v[LARGE_SIZE * MAX_SIZE];
+
+static void test_ffge_wiedemann_unit(void)
+{
+	struct ffge_wiedemann_stats st;
+
+	/* full rank: the minimal polynomial has no factor x */
+	const size_t rp1[] = { 0, 2, 4 }, ci1[] = { 0, 1, 0, 1 };
+	const int64_t v1[] = { 1, 1, 1, -1 };
+	TEST_EQ(ffge_wiedemann_rank(rp1, ci1, v1, 2, 2, 4, 3, &st), 2);
+	TEST_EQ(st.degree, 2);
+
+	/* a weighted cyclic permutation, more threads than rows */
+	const size_t rp2[] = { 0, 1, 2, 3, 4 }, ci2[] = { 1, 2, 3, 0 };
+	const int64_t v2[] = { 1, 2, 3, FFGE_PRIM - 4 };
+	TEST_EQ(ffge_wiedemann_rank(rp2, ci2, v2, 4, 4, FFGE_WIDTH, 5, &st),
+		4);
+	TEST_ASSERT(st.steps <= 2 * 5 && st.degree == 4,
+		"steps=%zu, degree=%zu", (size_t)st.steps, (size_t)st.degree);
+
+	/* rank 1: the minimal polynomial is x (x - c) */
+	const size_t rp3[] = { 0, 4, 8, 12 };
+	const size_t ci3[] = { 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3 };
+	const int64_t v3[] = { 1, 1, 1, 1, 2, 2, 2, 2, -1, -1, -1, -1 };
+	TEST_EQ(ffge_wiedemann_rank(rp3, ci3, v3, 3, 4, 2, 6, &st), 1);
+	TEST_EQ(st.degree, 2);
+
+	/* the last column is the sum of the other two */
+	const size_t rp4[] = { 0, 2, 4, 6, 9 };
+	const size_t ci4[] = { 0, 2, 1, 2, 0, 2, 0, 1, 2 };
+	const int64_t v4[] = { 1, 1, 1, 1, 5, 5, 2, 3, 5 };
+	TEST_EQ(ffge_wiedemann_rank(rp4, ci4, v4, 4, 3, 3, 7, &st), 2);
+
+	/* no non-zero elements, and no columns */
+	const size_t rp0[] = { 0, 0, 0, 0 };
+	TEST_EQ(ffge_wiedemann_rank(rp0, ci, v, 3, 4, 3, 8, &st), 0);
+	TEST_EQ(st.degree, 1);
+	TEST_EQ(ffge_wiedemann_rank(rp0, ci, v, 3, 0, 1, 9, nullptr), 0);
+}
+
+static void test_ffge_wiedemann_rank(size_t nr, size_t nc, size_t d,
+		size_t threads)
+{
+	const size_t nm = nr < nc ? nr : nc;
+	for (size_t rep = 0; rep < REPS; rep++) {
+		const size_t rnk = xoshiro256ss_next(&RNG) % 2 ?
+			nm : xoshiro256ss_next(&RNG) % (nm + 1);
+		const size_t rnk_exp = ffge_mat_genrand_sparse(a, b, nr, nc,
+			rnk, d, &RNG);
+		ffge_mat_to_csr(a, nr, nc, rp, ci, v);
+
+		size_t rnk_w = ffge_wiedemann_rank(rp, ci, v, nr, nc, threads,
+			xoshiro256ss_next(&RNG), nullptr);
+		TEST_ASSERT(rnk_w == rnk_exp, "rnk=%zu, rnk_exp=%zu, "
+			"nr=%zu, nc=%zu, d=%zu, threads=%zu, rep=%zu",
+				rnk_w, rnk_exp, nr, nc, d, threads, rep);
+	}
+}
+
+/* Compare with ffge_sparse_rank() for a larger matrix with a few non-zero
+ * elements per row, some of the rows and columns empty.
+ */
+static void test_ffge_wiedemann_large(size_t n, size_t threads)
+{
+	size_t l = 0;
+	for (size_t i = 0; i < n; i++) {
+		rp[i] = l;
+		for (size_t j = 0; j < n && i % 7 != 3; j++)
+			if (xoshiro256ss_next(&RNG) % n < LARGE_PER_ROW &&
+					j % 11 != 5) {
+				ci[l] = j;
+				v[l++] = xoshiro256ss_next(&RNG) % FFGE_PRIM;
+			}
+	}
+	rp[n] = l;
+
+	struct ffge_wiedemann_stats st;
+	const size_t rnk_exp = ffge_sparse_rank(rp, ci, v, n, n,
+		FFGE_SPARSE_DENSE, nullptr);
+	const size_t rnk = ffge_wiedemann_rank(rp, ci, v, n, n, threads,
+		xoshiro256ss_next(&RNG), &st);
+	TEST_ASSERT(rnk == rnk_exp, "rnk=%zu, rnk_exp=%zu, n=%zu, "
+		"threads=%zu", rnk, rnk_exp, n, threads);
+	TEST_ASSERT(st.steps <= 2 * (n + 1) && st.degree <= rnk + 1,
+		"steps=%zu, degree=%zu", (size_t)st.steps,
+			(size_t)st.degree);
+}
+
+static void TEST_MAIN(void)
+{
+	xoshiro256ss_init(&RNG, SEED);
+
+	test_ffge_wiedemann_unit();
+
+	/* sizes around the split of the rows among the threads */
+	for (size_t t = 1; t <= FFGE_WIDTH; t++) {
+		test_ffge_wiedemann_rank(t, t, 2, t);
+		test_ffge_wiedemann_rank(t + 1, 3 * t, 3, t);
+		test_ffge_wiedemann_rank(4 * t + 3, 2 * t, 5, t);
+	}
+	test_ffge_wiedemann_rank(MAX_SIZE, MAX_SIZE, 7, 1);
+	test_ffge_wiedemann_rank(MAX_SIZE, MAX_SIZE, 2, FFGE_WIDTH);
+
+	test_ffge_wiedemann_large(LARGE_SIZE / 2, 1);
+	test_ffge_wiedemann_large(LARGE_SIZE, 4);
+}
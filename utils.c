@@ -18,59 +18,161 @@
  * -------------------------------------------------------------------------- */
 #include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "ffge.h"
 #include "utils.h"
 #include "xoshiro256ss.h"
 
-void ffge_mat_genrand_prim(int64_t *m, size_t n, size_t rnk, size_t rd,
-			struct xoshiro256ss *rng)
+void ffge_mat_genrand_prim(int64_t *m, size_t nr, size_t nc, size_t rnk,
+			size_t rd, struct xoshiro256ss *rng)
 {
-	for (size_t i = 0; i < n; i++)
-		for (size_t j = 0; j < n; j++)
-			m[i*n + j] = (i == j && i < rnk) ? 1 : 0;
+	for (size_t i = 0; i < nr; i++)
+		for (size_t j = 0; j < nc; j++)
+			m[i*nc + j] = (i == j && i < rnk) ? 1 : 0;
 
 	while (rd-- > 0) {
 		size_t r1, r2, c1, c2, rc[8];	/* random rows, columns */
 		int ss[2];			/* random signs */
 
-		for (size_t i = 0; i < 8; i++)
-			rc[i] = xoshiro256ss_next(rng) % n;
+		for (size_t i = 0; i < 8; i++)		/* rows, cols, ... */
+			rc[i] = xoshiro256ss_next(rng) % (i & 2 ? nc : nr);
 		for (size_t i = 0; i < 2; i++)
 			ss[i] = (xoshiro256ss_next(rng) % 2) * 2 - 1;
 
 		/* swap rows */
 		r1 = rc[0]; r2 = rc[1];
 		if (r1 != r2)
-			for (size_t j = 0; j < n; j++) {
+			for (size_t j = 0; j < nc; j++) {
 				int64_t *x, *y, zz;
-				zz = *(x = m + r1*n + j);
-				*x = *(y = m + r2*n + j);
+				zz = *(x = m + r1*nc + j);
+				*x = *(y = m + r2*nc + j);
 				*y = zz;
 			}
 
 		/* swap columns */
 		c1 = rc[2]; c2 = rc[3];
 		if (c1 != c2)
-			for (size_t i = 0; i < n; i++) {
+			for (size_t i = 0; i < nr; i++) {
 				int64_t *x, *y, zz;
-				zz = *(x = m + i*n + c1);
-				*x = *(y = m + i*n + c2);
+				zz = *(x = m + i*nc + c1);
+				*x = *(y = m + i*nc + c2);
 				*y = zz;
 			}
 
 		/* add rows */
 		r1 = rc[4]; r2 = rc[5];
 		if (r1 != r2)
-			for (size_t j = 0; j < n; j++)
-				m[r1*n + j] =
-				(m[r1*n + j] + ss[0] * m[r2*n + j]) % FFGE_PRIM;
+			for (size_t j = 0; j < nc; j++)
+				m[r1*nc + j] = (m[r1*nc + j] +
+					ss[0] * m[r2*nc + j]) % FFGE_PRIM;
 
 		/* add columns */
 		c1 = rc[6]; c2 = rc[7];
 		if (c1 != c2)
-			for (size_t i = 0; i < n; i++)
-				m[i*n + c1] =
-				(m[i*n + c1] + ss[1] * m[i*n + c2]) % FFGE_PRIM;
+			for (size_t i = 0; i < nr; i++)
+				m[i*nc + c1] = (m[i*nc + c1] +
+					ss[1] * m[i*nc + c2]) % FFGE_PRIM;
+	}
+}
+
+void ffge_mat_genrand_sym(int64_t *m, size_t n, size_t rnk, size_t rd,
+			struct xoshiro256ss *rng)
+{
+	for (size_t i = 0; i < n; i++)
+		for (size_t j = 0; j < n; j++)
+			m[i*n + j] = 0;
+	for (size_t i = 0; i < rnk; i++)	/* random signs */
+		m[i*n + i] = (int64_t)(xoshiro256ss_next(rng) % 2) * 2 - 1;
+
+	while (rd-- > 0) {
+		const size_t r1 = xoshiro256ss_next(rng) % n;
+		const size_t r2 = xoshiro256ss_next(rng) % n;
+		const int ss = (xoshiro256ss_next(rng) % 2) * 2 - 1;
+		if (r1 == r2)
+			continue;
+
+		/* swap rows and columns */
+		if (xoshiro256ss_next(rng) % 4 == 0) {
+			for (size_t j = 0; j < n; j++) {
+				int64_t *x, *y, zz;
+				zz = *(x = m + r1*n + j);
+				*x = *(y = m + r2*n + j);
+				*y = zz;
+			}
+			for (size_t i = 0; i < n; i++) {
+				int64_t *x, *y, zz;
+				zz = *(x = m + i*n + r1);
+				*x = *(y = m + i*n + r2);
+				*y = zz;
+			}
+			continue;
+		}
+
+		/* add rows and columns */
+		for (size_t j = 0; j < n; j++)
+			m[r1*n + j] = (m[r1*n + j] +
+				ss * m[r2*n + j]) % FFGE_PRIM;
+		for (size_t i = 0; i < n; i++)
+			m[i*n + r1] = (m[i*n + r1] +
+				ss * m[i*n + r2]) % FFGE_PRIM;
+	}
+}
+
+/* Random element: one in d is non-zero. */
+static int64_t ffge_rand_sparse(size_t d, struct xoshiro256ss *rng)
+{
+	if (xoshiro256ss_next(rng) % d != 0)
+		return 0;
+	if (xoshiro256ss_next(rng) % 2)
+		return xoshiro256ss_next(rng) % 2 ? 1 : -1;
+
+	return xoshiro256ss_next(rng) % FFGE_PRIM;
+}
+
+size_t ffge_mat_genrand_sparse(int64_t *m, int64_t *w, size_t nr, size_t nc,
+			size_t rnk, size_t d, struct xoshiro256ss *rng)
+{
+	if (rnk >= nr || rnk >= nc) {
+		for (size_t i = 0; i < nr * nc; i++)
+			m[i] = ffge_rand_sparse(d, rng);
+	} else {
+		/* the sum of rnk products of a column by a row */
+		int64_t *g = malloc(nc * sizeof *g);
+		if (!g)
+			abort();
+		for (size_t i = 0; i < nr * nc; i++)
+			m[i] = 0;
+		for (size_t k = 0; k < rnk; k++) {
+			for (size_t j = 0; j < nc; j++)
+				g[j] = ffge_rand_sparse(2, rng);
+			for (size_t i = 0; i < nr; i++) {
+				const int64_t f = ffge_rand_sparse(2, rng);
+				for (size_t j = 0; j < nc; j++)
+					m[i*nc + j] = (m[i*nc + j] +
+						f * g[j]) % FFGE_PRIM;
+			}
+		}
+		free(g);
+	}
+	memcpy(w, m, nr * nc * sizeof *m);
+
+	return ffge_prim(w, nr, nc);
+}
+
+void ffge_mat_to_csr(const int64_t *m, size_t nr, size_t nc, size_t *rp,
+			size_t *ci, int64_t *v)
+{
+	size_t l = 0;
+
+	for (size_t i = 0; i < nr; i++) {
+		rp[i] = l;
+		for (size_t j = 0; j < nc; j++)
+			if (m[i*nc + j] != 0) {
+				ci[l] = j;
+				v[l++] = m[i*nc + j];
+			}
 	}
+	rp[nr] = l;
 }
@@ -24,14 +24,44 @@
 
 #include "xoshiro256ss.h"
 
-/* Generate a random square matrix of size n and having rank equal to rnk <= n.
+/* Generate a random matrix of nr rows and nc columns, having rank equal to
+ * rnk <= min(nr, nc).
  *
  * The element of the matrix are numbers from Z_p prime field for
- * p = FFGE_PRIM. Both n and rnk are assumed to be less than FFGE_PRIM.
+ * p = FFGE_PRIM. Both nr, nc and rnk are assumed to be less than FFGE_PRIM.
  *
  * Perform at most rd rounds of elementary matrix row and column operations.
  */
-void ffge_mat_genrand_prim(int64_t *m, size_t n, size_t rnk, size_t rd,
+void ffge_mat_genrand_prim(int64_t *m, size_t nr, size_t nc, size_t rnk,
+			size_t rd, struct xoshiro256ss *rng);
+
+/* Generate a random symmetric matrix of size n, having rank equal to
+ * rnk <= n, stored row by row (both triangles).
+ *
+ * The elements are from Z_p for p = FFGE_PRIM.  Perform at most rd rounds
+ * of symmetric row and column operations, i.e. congruences.
+ */
+void ffge_mat_genrand_sym(int64_t *m, size_t n, size_t rnk, size_t rd,
 			struct xoshiro256ss *rng);
 
+/* Generate a random sparse matrix of nr rows and nc columns, with elements
+ * from Z_p for p = FFGE_PRIM.  About one in d elements is non-zero, and half
+ * of those are 1 or -1, which makes cancellation during elimination likely.
+ *
+ * If rnk < min(nr, nc), the matrix is instead the product of two such
+ * matrices of inner size rnk, with d = 2, hence of rank at most rnk.
+ *
+ * Return the rank, computed by ffge_prim() on a copy of m in w, a buffer of
+ * nr*nc elements.
+ */
+size_t ffge_mat_genrand_sparse(int64_t *m, int64_t *w, size_t nr, size_t nc,
+			size_t rnk, size_t d, struct xoshiro256ss *rng);
+
+/* Store the non-zero elements of the matrix m of nr rows and nc columns in
+ * the compressed sparse row format of ffge_sparse_rank().  The arrays ci and
+ * v must hold as many elements as are non-zero, and rp must hold nr + 1.
+ */
+void ffge_mat_to_csr(const int64_t *m, size_t nr, size_t nc, size_t *rp,
+			size_t *ci, int64_t *v);
+
 #endif /* UTILS_H */